@@ -1,3 +1,23 @@
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+/**
+ * std::allocator that counts what is currently allocated through it.
+ */
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+  static int64_t live;
+  template <typename U> struct rebind { typedef counting_allocator<U> other; };
+  counting_allocator() {}
+  template <typename U> counting_allocator(const counting_allocator<U> &) {}
+  T* allocate(size_t n) { live++; return std::allocator<T>::allocate(n); }
+  void deallocate(T *p, size_t n) { live--; std::allocator<T>::deallocate(p, n); }
+};
+template <typename T> int64_t counting_allocator<T>::live = 0;
+
+// all the limbs of the tests go through it, test_scratch checks they come back.
+#define BIGINT_ALLOCATOR counting_allocator<uint64_t>
 #include "bigint.hpp"
 #include <iostream>
 #include <climits>
@@ -29,6 +49,7 @@ std::vector<std::pair<uint8_t, std::pair<const char*, std::vector<uint64_t>>>> u
   {10, {"18446744073709551615", {18446744073709551615ULL}}}, // 2^64-1
   {10, {"18446744073709551616", {0ULL, 1ULL}}}, // 2^64 -- this should leave the lowest data element completely zero.
   {10, {"18446744073709551617", {1ULL, 1ULL}}}, // 2^64+1
+  {10, {"0000000000000000000000000000018446744073709551617", {1ULL, 1ULL}}}, // leading zeros across a chunk boundary
   // Octal tests
   {8, {"10", {8}}},
   {8, {"100", {64}}},
@@ -215,6 +236,11 @@ std::vector<std::pair<uint8_t, std::vector<std::string>>> long_inputs_mul = {
   {16, {"ffffffff", "ffffffff", "fffffffe00000001"}},
   {16, {"ffffffffffffffff", "10", "ffffffffffffffff0"}},
   {16, {"ffffffffffffffff", "ffffffffffffffff", "fffffffffffffffe0000000000000001"}},
+  {16, {"ffffffffffffffffffffffffffffffffffffffffffffffff", "fffffffffffffffffffffffffffffffffffffff1",
+    "fffffffffffffffffffffffffffffffffffffff0ffffffff000000000000000000000000000000000000000f"}},
+  {16, {"7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffed", "100000000000000000000000000000000002bdc545d6b4b87",
+    "800000000000000000000000000000000015ee2a2eb5a5c37fffffffffffffecfffffffffffffffffffffffffffffffffcbea5bd110964fb"}},
+  {10, {"-12345678901234567890", "98765432109876543210", "-1219326311370217952237463801111263526900"}},
   {10, {"64327169238471629502469567364910832756873465735476879721010293898587498723940047598475834758738768762",
     "97789823471987728818821987959848599834752987349587877453416324786667364216900987234787547934754777236661551128937987573888372349872394793287498888737465167777",
     "629054252428281994977829225250454807300460884868936239424485875727138"
@@ -252,6 +278,49 @@ bool test_mul() {
   return false; 
 }
 
+/**
+ * fills v with pseudo random limbs (xorshift), so that large operands don't need to be
+ * spelled out in the source.
+ */
+void fill_pseudo_random(std::vector<uint64_t> &v, uint64_t &state) {
+  for (size_t i = 0; i < v.size(); ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    v[i] = state;
+  }
+}
+
+/**
+ * compares the size-dispatched multiplication (karatsuba, toom-3, ntt, unbalanced operands)
+ * against the schoolbook kernel.
+ */
+void test_mul_large() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0x2545f4914f6cdd1dULL;
+  const size_t sizes[][2] = {{31, 31}, {32, 32}, {33, 17}, {64, 33}, {65, 65}, {100, 37}, {127, 127}, {128, 128},
+                             {129, 87}, {200, 199}, {300, 40}, {301, 200}, {512, 512}, {700, 300}, {1000, 999},
+                             {3072, 3072}, {5000, 3100}, {9000, 4000}};
+  for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i) {
+    std::vector<uint64_t> a(sizes[i][0]), b(sizes[i][1]);
+    fill_pseudo_random(a, state);
+    fill_pseudo_random(b, state);
+    // all-ones operands maximize the carries in the evaluation and interpolation steps.
+    if (i % 3 == 0)
+      std::fill(a.begin(), a.end(), ~0ULL);
+    std::vector<uint64_t> expected(a.size() + b.size()), result(a.size() + b.size());
+    BigInt::limbs_mul_basecase(&expected[0], &a[0], a.size(), &b[0], b.size());
+    BigInt::limbs_mul(&result[0], &a[0], a.size(), &b[0], b.size());
+    if (result != expected) {
+      badcount++;
+      cout << "test_mul_large error at " << sizes[i][0] << "x" << sizes[i][1] << endl;
+    } else {
+      goodcount++;
+    }
+  }
+  cout << "large multiplication test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
 std::vector<std::pair<uint8_t, std::vector<std::string>>> inputs_sub = {
   {16, {"ffff", "fff0", "f"}},
   {16, {"1ffffffffffffffff", "ffffffffffffffff", "10000000000000000"}},
@@ -317,6 +386,8 @@ std::vector<std::pair<uint8_t, std::vector<std::string>>> inputs_div = {
   {16, {"ffffffff",         "3",  "55555555"}},
   {16, {"ffffffffffffffffffffffff", "3", "555555555555555555555555"}},
   {16, {"ffffffffffffffffffffffffffff", "235252387897234987897874329", "73"}},
+  {16, {"ffffffffffffffffffffffffffffffffffffffffffffffff", "ffffffffffffffff0000000000000001", "10000000000000000"}},
+  {16, {"7fffffffffffffff8000000000000000000000000000000000000000", "800000000000000000000000000000000000000000000001", "ffffffff"}},
   {16, {"2ec44d0e71c5f162f424c754569a688fcbe4d9416e0c3f021f2180e8ff3c7e49333ae0cfd54be6f7436915cc1238f1ac94a87be094971982b38bbd41142eaccc3e365ed0cdfb11d8d8f35ccdd5f0dd06e3b19926d60e27d6ca905a65cf77bc170951960945f316bf9327a0e2294a8126418253718c4e391ed0af071d7338825f3",
         "3cc918f9dbdb436192873d1e4d01d4b7a254794e76811c81f102b05dad15a81810ddd97cf6c62903db7fe00dafbf9a6907d9f5b4210c38689d94f3032350547ffa1fc47c48951a5308e8d3b4454d02cc50280d65fdee741d19ce2d1860d54d6a0b1ab755",
         "c4f5aeaf07e8bca57c342d91f3c404d8174be6ab495593db5108ea2dc"}},
@@ -345,6 +416,101 @@ bool test_div() {
   return false;
 }
 
+const char *divmod_limb_dividend =
+  "2ec44d0e71c5f162f424c754569a688fcbe4d9416e0c3f021f2180e8ff3c7e49333ae0cfd54be6f7"
+  "436915cc1238f1ac94a87be094971982b38bbd41142eaccc3e365ed0cdfb11d8d8f35ccdd5f0dd06"
+  "e3b19926d60e27d6ca905a65cf77bc170951960945f316bf9327a0e2294a8126418253718c4e391e"
+  "d0af071d7338825f3";
+// divisor, {quotient (hex), remainder}
+std::vector<std::pair<uint64_t, std::pair<const char *, uint64_t>>> inputs_divmod_limb = {
+  {0x3ULL, {"f96c45a25eca5cba6b6ed1c1cde22da994c486b24aebfab5fb5d5a2ffbed4c31113a04547194cfd1"
+        "6785c995b68508edc38294adc325dd63bd93f15b164e44414bcca4599fe5b4848511eef475049acf"
+        "6908862475a0d4798dac8cc9a7d3eb2587087586ca65cea86628af60dc3806215d61bd0841a130a4"
+        "58fad09d112d61fb",
+        2ULL}},
+  {0xaULL, {"4ad3ae7d82d64f04b9d472208a90a74c796e2868b0139803650267db31fa63a851f7ce1955463e58"
+        "6bdb5613505b1c475440c63420f1c26ab8df9534ed177ae0638a314e165e82f48e522e16231afb3e"
+        "391c283e2349d957aa8090a2e58c6024dbb5bcdba31e8acc1ea5ce36a877350a026a1f1c13b05b64"
+        "81180b6251f403cb",
+        5ULL}},
+  {0xffffffffffffffffULL, {"2ec44d0e71c5f16322e91462c86059f2eecdeda4366c98f50def6e8d35a9173e412a4f5d0af4fe35"
+        "849365291d2defe2193be109b1c50964ccc79e4ac5f3b6310afdfd1b93eec809e3f159e969dfa510"
+        "c7a2f3103fedcce792334d760f6588fe9b84e37f55589fbe2eac84617ea320e4702ed7d30af15a03"
+        "4",
+        999217509491918375ULL}},
+  {0x8000000000000000ULL, {"5d889a1ce38be2c5e8498ea8ad34d11f97c9b282dc187e043e4301d1fe78fc926675c19faa97cdee"
+        "86d22b982471e3592950f7c1292e330567177a82285d59987c6cbda19bf623b1b1e6b99babe1ba0d"
+        "c763324dac1c4fad9520b4cb9eef782e12a32c128be62d7f264f41c45295024c8304a6e3189c723d"
+        "a",
+        788255103886304755ULL}},
+  {0x8ac7230489e80000ULL, {"5644ff4c1c1ceb13e7fe50e12b4e913ca05d621248ba33cd2af7ff3a065e8a8b5da6057af119bca2"
+        "7977285a2f4ae6057f7e50228e138ed1055a0f050c13243d2222bc3353bc486c796e1ea3f39010aa"
+        "86d4333e2fac9acccb62cca916620044daec1396bcf05b71a2f51ea80bf686e01a8f241337737d19"
+        "d",
+        6335661565290751475ULL}},
+};
+
+void test_divmod_limb() {
+  uint64_t goodcount = 0, badcount = 0;
+  for (size_t i = 0; i < inputs_divmod_limb.size(); ++i) {
+    BigInt a(divmod_limb_dividend, 16);
+    BigInt expected(inputs_divmod_limb[i].second.first, 16);
+    uint64_t d = inputs_divmod_limb[i].first;
+    uint64_t mod = a.mod_limb(d);
+    uint64_t rem = a.divmod_limb(d);
+    if (a != expected || rem != inputs_divmod_limb[i].second.second || mod != rem) {
+      badcount++;
+      cout << "test_divmod_limb error at #" << i << endl;
+    } else {
+      goodcount++;
+    }
+  }
+
+  // signs follow truncating division, a zero result is never negative.
+  if ((BigInt("-7") % BigInt(3ULL)).toString() != "-1" || (BigInt("-7") / BigInt(3ULL)).toString() != "-2"
+      || (BigInt("-6") % BigInt(3ULL)).is_neg() || (BigInt("-2") / BigInt(3ULL)).is_neg()) {
+    badcount++;
+    cout << "test_divmod_limb error: signs" << endl;
+  } else {
+    goodcount++;
+  }
+  cout << "single limb div test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+BigInt from_pseudo_random(size_t limbs, uint64_t &state) {
+  std::vector<uint64_t> v(limbs);
+  fill_pseudo_random(v, state);
+  BigInt result;
+  for (size_t i = 0; i < v.size(); ++i)
+    result.add_bits_at_pos(i*64, v[i]);
+  return result;
+}
+
+/**
+ * checks a == q*d + r and r < d for divisions that go through the schoolbook and the
+ * newton reciprocal paths.
+ */
+void test_div_large() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  const size_t sizes[][2] = {{40, 3}, {300, 299}, {600, 100}, {2500, 1250}, {4000, 1300}, {5000, 4000}};
+  for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i) {
+    BigInt a = from_pseudo_random(sizes[i][0], state);
+    BigInt d = from_pseudo_random(sizes[i][1], state);
+    BigInt r;
+    BigInt q = a.div_abs(d, r);
+    BigInt check = q * d;
+    check += r;
+    if (check != a || !r.lt_abs(d)) {
+      badcount++;
+      cout << "test_div_large error at " << sizes[i][0] << "/" << sizes[i][1] << endl;
+    } else {
+      goodcount++;
+    }
+  }
+  cout << "large div test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
 std::vector<std::pair<uint8_t, std::vector<std::string>>> inputs_strep = {
   // TODO: Once the performance problems with toString are at least halfway fixed, add more.
   {16, {
@@ -427,14 +593,974 @@ void test_strrep() {
   return;
 }
 
+/**
+ * round trips numbers that are large enough for the divide and conquer conversion,
+ * including long runs of zeros that end up in the zero-padded lower halves.
+ */
+void test_strrep_large() {
+  uint64_t goodcount = 0, badcount = 0;
+  std::vector<std::pair<uint8_t, std::string>> inputs;
+  std::string digits;
+  for (size_t i = 0; i < 6000; ++i)
+    digits.push_back('0' + (i*7 + i/13) % 10);
+  inputs.push_back(std::make_pair(10, "9" + digits));
+  inputs.push_back(std::make_pair(10, "1" + std::string(3000, '0') + "1" + std::string(1500, '0')));
+  inputs.push_back(std::make_pair(10, "-" + std::string(2500, '9')));
+  inputs.push_back(std::make_pair(7, "6" + std::string(4000, '3')));
+  inputs.push_back(std::make_pair(10, "0"));
+
+  for (auto it = inputs.begin(); it != inputs.end(); ++it) {
+    BigInt bi(it->second, it->first);
+    string result = bi.toString(it->first);
+    if (result != it->second) {
+      cout << "error: large from/to string conversion (base " << (int)it->first << ", "
+           << it->second.size() << " digits)" << endl;
+      badcount++;
+    } else {
+      goodcount++;
+    }
+  }
+  cout << "large toString test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+/**
+ * power of two radixes are converted by bit packing, check them against the digits of a
+ * number that was parsed in base 10.
+ */
+void test_strrep_pow2() {
+  uint64_t goodcount = 0, badcount = 0;
+  BigInt bi("97789823471987728818821987959848599834752987349587877453480651955905835846403456802152458767511650702397028008658997867786959848596334840885974723496203936539");
+  const uint8_t radixes[] = {2, 4, 8, 16, 32};
+  for (size_t i = 0; i < sizeof(radixes); ++i) {
+    string s = bi.toString(radixes[i]);
+    if (BigInt(s, radixes[i]) != bi || BigInt(s, radixes[i]).toString(10) != bi.toString(10)) {
+      cout << "error: base " << (int)radixes[i] << " round trip: " << s << endl;
+      badcount++;
+    } else {
+      goodcount++;
+    }
+  }
+  string hex_upper = bi.toString(16, true);
+  if (hex_upper != "1C7D7F8C53E0FFCB7FCC6191CB9057FF42DEEA9E4AAB76555B3C6D37C1257EA5CFD7F12264363E6C9A738599EE53F01D8AF30FC81F17CB0DC90167A14B0D592A631B"
+      || BigInt(hex_upper, 16) != bi) {
+    cout << "error: uppercase hex: " << hex_upper << endl;
+    badcount++;
+  } else {
+    goodcount++;
+  }
+  cout << "power of two radix test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_inline_storage() {
+  uint64_t goodcount = 0, badcount = 0;
+  // walk a value across the inline/heap boundary of the limb buffer and back,
+  // copying it at every size on the way.
+  const BigInt a(1ULL), step(1ULL << 13);
+  std::vector<BigInt> copies;
+  copies.push_back(a);
+  while (copies.back().get_internal_representation().size() < 3 * BIGINT_INLINE_LIMBS)
+    copies.push_back(copies.back() * step);
+  for (size_t k = 0; k < copies.size(); ++k) {
+    BigInt b = copies[k];
+    for (size_t j = 0; j < k; ++j)
+      b.divmod_limb(1ULL << 13);
+    BigInt c;
+    c = copies[k];
+    c = c / copies[k];
+    if (b != a || c != a || copies[k].get_internal_representation().size() != 13 * k / BigInt::internal_bitlen + 1) {
+      badcount++;
+      cout << "test_inline_storage error at #" << k << endl;
+    } else {
+      goodcount++;
+    }
+  }
+  cout << "inline storage test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+/**
+ * stateful allocator that goes along on copy assignment, with a count of what each of the
+ * two instances has handed out.
+ */
+template <typename T>
+struct tagged_allocator : std::allocator<T> {
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::false_type is_always_equal;
+  static int64_t live[2];
+  int tag;
+  template <typename U> struct rebind { typedef tagged_allocator<U> other; };
+  explicit tagged_allocator(int t = 0) : tag(t) {}
+  template <typename U> tagged_allocator(const tagged_allocator<U> &other) : tag(other.tag) {}
+  T* allocate(size_t n) { live[tag]++; return std::allocator<T>::allocate(n); }
+  void deallocate(T *p, size_t n) { live[tag]--; std::allocator<T>::deallocate(p, n); }
+  bool operator==(const tagged_allocator &other) const { return tag == other.tag; }
+  bool operator!=(const tagged_allocator &other) const { return tag != other.tag; }
+};
+template <typename T> int64_t tagged_allocator<T>::live[2] = {0, 0};
+
+void test_scratch() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0x5eed5eed;
+
+  // the second round of the same work must not grow the arena
+  {
+    const BigInt a = from_pseudo_random(6000, state), b = from_pseudo_random(2500, state);
+    const BigInt c = from_pseudo_random(200, state);
+    BigInt first, second;
+    size_t reserved = 0;
+    for (int round = 0; round < 2; ++round) {
+      BigInt x = a * b;
+      x *= c;
+      BigInt r(x % b);
+      x = x / c;
+      x += r;
+      (round ? second : first) = x;
+      if (!round)
+        reserved = ScratchArena::local().reserved();
+    }
+    if (first != second || !reserved || ScratchArena::local().reserved() != reserved) {
+      badcount++;
+      cout << "test_scratch error: arena reuse" << endl;
+    } else {
+      goodcount++;
+    }
+  }
+
+  // heap storage goes through the allocator, and all of it is returned.
+  {
+    typedef SmallVector<uint64_t, 2, counting_allocator<uint64_t> > vec;
+    vec v(2, 7);
+    bool ok = counting_allocator<uint64_t>::live == 0;
+    v.push_back(8);
+    vec w(v), z;
+    z = std::move(w);
+    ok = ok && counting_allocator<uint64_t>::live == 2 && z.size() == 3 && z[2] == 8 && w.empty();
+    // so do the limbs of BigInt, with BIGINT_ALLOCATOR defined at the top
+    BigInt small(7ULL);
+    ok = ok && counting_allocator<uint64_t>::live == 2;
+    const BigInt large(from_pseudo_random(BIGINT_INLINE_LIMBS + 1, state));
+    ok = ok && counting_allocator<uint64_t>::live == 3;
+    small = large;
+    ok = ok && counting_allocator<uint64_t>::live == 4 && small == large;
+    if (!ok) {
+      badcount++;
+      cout << "test_scratch error: allocator" << endl;
+    } else {
+      goodcount++;
+    }
+  }
+  // copy assignment takes the allocator along, the old buffer goes back to its own
+  {
+    typedef SmallVector<uint64_t, 2, tagged_allocator<uint64_t> > vec;
+    vec a((tagged_allocator<uint64_t>(0))), b((tagged_allocator<uint64_t>(1)));
+    for (uint64_t i = 0; i < 3; ++i) {
+      a.push_back(i);
+      b.push_back(i + 10);
+    }
+    a = b;
+    bool ok = a.get_allocator().tag == 1 && a.size() == 3 && a[2] == 12;
+    ok = ok && tagged_allocator<uint64_t>::live[0] == 0 && tagged_allocator<uint64_t>::live[1] == 2;
+    // a move between unequal allocators copies into our own
+    vec c((tagged_allocator<uint64_t>(0)));
+    c = std::move(a);
+    ok = ok && c.get_allocator().tag == 0 && c.size() == 3 && c[0] == 10 && a.empty();
+    ok = ok && tagged_allocator<uint64_t>::live[0] == 1 && tagged_allocator<uint64_t>::live[1] == 2;
+    if (!ok) {
+      badcount++;
+      cout << "test_scratch error: allocator propagation" << endl;
+    } else {
+      goodcount++;
+    }
+  }
+  if (counting_allocator<uint64_t>::live != 0 || tagged_allocator<uint64_t>::live[0] != 0
+      || tagged_allocator<uint64_t>::live[1] != 0) {
+    badcount++;
+    cout << "test_scratch error: allocator leak" << endl;
+  } else {
+    goodcount++;
+  }
+  cout << "scratch memory test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+BigInt from_int64(int64_t v) {
+  return BigInt(v < 0 ? 0 - (uint64_t)v : (uint64_t)v, v < 0);
+}
+
+void test_signed_ops() {
+  uint64_t goodcount = 0, badcount = 0;
+  const int64_t values[] = {-1000000007, -65536, -7, -3, -1, 0, 1, 2, 3, 7, 65536, 1000000007};
+  for (int64_t x : values) {
+    for (int64_t y : values) {
+      BigInt a = from_int64(x), b = from_int64(y);
+      bool ok = a + b == from_int64(x + y) && a - b == from_int64(x - y) && a * b == from_int64(x * y);
+      if (y) {
+        ok = ok && a / b == from_int64(x / y) && a % b == from_int64(x % y);
+      }
+      // the overloads for temporaries have to agree with the copying ones.
+      ok = ok && BigInt(a) + b == a + b && a + BigInt(b) == a + b && BigInt(a) + BigInt(b) == a + b;
+      ok = ok && BigInt(a) - b == a - b && a - BigInt(b) == a - b && BigInt(a) - BigInt(b) == a - b;
+      ok = ok && BigInt(a) * b == a * b && a * BigInt(b) == a * b && BigInt(a) / b == a / b;
+      if (!ok) {
+        badcount++;
+        cout << "test_signed_ops error at " << x << ", " << y << endl;
+      } else {
+        goodcount++;
+      }
+    }
+  }
+
+  // multi-limb operands, with every sign combination.
+  uint64_t state = 0xfeedbeef;
+  for (int i = 0; i < 16; ++i) {
+    BigInt a(from_pseudo_random(7 + i, state), i & 1);
+    BigInt b(from_pseudo_random(3 + (i % 5) * 2, state), i & 2);
+    BigInt c(from_pseudo_random(2 + i % 3, state), i & 4);
+    BigInt q = a / b, r = a % b;
+    bool ok = (a + b) - b == a && (a - b) + b == a && a - b == BigInt(0ULL) - (b - a);
+    ok = ok && q * b + r == a && r.lt_abs(b) && (r.is_zero() || r.is_neg() == a.is_neg());
+    ok = ok && a*b + a*c == a*(b + c) && (a*b) / b == a && (a*b) % b == BigInt(0ULL);
+    BigInt x(a);
+    ((x += b) -= c) *= c;
+    ok = ok && x == (a + b - c) * c;
+    BigInt y(std::move(x));
+    ok = ok && x.is_zero() && !x.is_neg() && y == (a + b - c) * c;
+    x = std::move(y);
+    ok = ok && y.is_zero() && x == (a + b - c) * c;
+    if (!ok) {
+      badcount++;
+      cout << "test_signed_ops error at #" << i << endl;
+    } else {
+      goodcount++;
+    }
+  }
+  cout << "signed operator test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_carry_chains() {
+  uint64_t goodcount = 0, badcount = 0;
+  for (size_t limbs = 1; limbs < 40; limbs += 3) {
+    // 2^(64*limbs) - 1, the carry of +1 runs through every limb.
+    const std::string ones(limbs * 16, 'f');
+    const BigInt all_ones(ones, 16), one(1ULL);
+    const BigInt power(std::string("1") + std::string(limbs * 16, '0'), 16);
+    BigInt x(all_ones), y(one), z(power);
+    x += one;
+    y += all_ones;
+    z -= one;
+    BigInt doubled(all_ones);
+    doubled += doubled;
+    BigInt zero(all_ones);
+    zero -= zero;
+    if (x != power || y != power || z != all_ones || doubled != all_ones * BigInt(2ULL)
+        || !zero.is_zero() || zero.is_neg() || one - power != BigInt(0ULL) - all_ones) {
+      badcount++;
+      cout << "test_carry_chains error at " << limbs << " limbs" << endl;
+    } else {
+      goodcount++;
+    }
+  }
+  cout << "carry chain test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_shift_operators() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0x5417;
+  const BigInt values[] = {BigInt(1ULL), BigInt(0x8000000000000000ULL), from_pseudo_random(5, state),
+                           BigInt(from_pseudo_random(3, state), true), BigInt(0ULL)};
+  for (const BigInt &x : values) {
+    BigInt pow2(1ULL);
+    for (uint64_t w = 0; w < 300; ++w, pow2 += pow2) {
+      BigInt l(x), r(x);
+      l <<= w;
+      r >>= w;
+      auto rep_l = l.get_internal_representation(), rep_r = r.get_internal_representation();
+      bool ok = l == x * pow2 && l == (x << w) && r == x / pow2 && r == (x >> w)
+                && (l >> w) == x && BigInt(x) << w == l && BigInt(x) >> w == r
+                && (rep_l.empty() || rep_l.back()) && (rep_r.empty() || rep_r.back());
+      if (!ok) {
+        badcount++;
+        cout << "test_shift_operators error at " << x.toString() << ", " << w << endl;
+      } else {
+        goodcount++;
+      }
+    }
+  }
+  cout << "shift operator test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+// base, exponent, modulus, expected result, all hex
+std::vector<std::vector<std::string>> inputs_powmod = {
+  {"ef5e7d7a3a862aac5826a9974368903d646c2d6447d433985b11bb37b54c395077616364568c43961dfc388c3d5df9725e06e22dfff3f4ecb1dcec40db7aca5825b2116aae6cff55ce0c3f08e12656f10e11160004524a7c3d2bd371fc80be13e9bb466a287385820942dc06bc69f2658575062102fbcd4f357fbc5af71a1bfc",
+   "12d6afd60c2377526537307d1dc0b5d4e44f2a3119917326db05ece1e316ac9526d522e87eb7578787ad23ff495fbdb104731888b815c7c5d8169727b0c39f25c8f40e9df02503929d3246282c14f06488b020b723ebe36e321a16f504cccda3d6bc8874f1ed255ff58ed9f87d81739b10dad339fec3a6f6cf439961dd132f51c6e22ec667b4a9487359c053a5442840b1abac56ee22b9b550ae014491d255c0707620135c26a157cc8dd3f2908fa0bb760b19461436ad1a7d57d3926b7cf30cd7369de5749e0f7793c012aa3b3c1aa16ba3be7682e92419ba03fc6fecc233984e3e52d639302a9050391192cc308fc05aec4989dfe15e7834d474c0db9b3642",
+   "df5b93b37b20e67290a4e3007ffb2d79d2a22f49288b41c8414b564af1cab80f0f358f6ce4d94090735f7c490a97cdae107019ca4986bc5817a3b742bdb92263f7be690ced904db842910ef4d70a6aec03f12d35604b415a63c915037e135e2fad27fddb1d8ae4422463eba47975589f45bf1e0ccbd0951bd672b96fe85008d5c1da023712fed568c825f34271095291dec3f215560fb97979fef3c0e7a16644630b55b75179fba1a04bb173d32eca482a1fa7bd4facf6e94f63c0fd3c39fecb140c1f555a92baad8004aba8f2b8d77e8b2f76e82de0cd6a3b7c80968086c746ec31bec766c609b24bbaf5498e13db3aebe7b475d729d75db9bdfa0e77fa34b5",
+   "7089e27725a889e284500c3f8f4f03a75ca40b928a851b69b1806cf900663504c40a1f3fecd28bdee4be6198f4bbe2b59d2c92970e8c5eaf2ebb9f456f0783d073f03e6c87ed1cfafcfbfbb1af7fc04c35ef9083a08c22215cc5bfc249a88a1be467224c970e72b13cd261d59fa1d405693fdf67ff9177daa71b81a2458293e6c4720ea118860435a42d4e056f2dd63b8e48e7c2780b7a0cc39d4c200f55bff950b0e38699b583e12d204e9847a9a99ea11af244a0f7a0663dcebad8a090d3d6bf5e5779432be901ff117eb15aabf6cbb5f2632f8343a2edb4e80a61501e02053d600067ca709486be85fe9641f07c5346877c6147137aac1b353fd4984380df"},
+  {"f5d91d00e8b14ebc6c4d7ffe6c9797670940fcbffd7801446ec0b053fc57f9a0875f9f73bee",
+   "b172f9726297e5293bc14e2624c71a8dab3b55a8c776589091",
+   "554666ca0e70d97e0248ebe79c5d9e3015bdfe00ada265af4170a47ab88dc979",
+   "32f1d13a2adb82c16ad8e5fdb4cb65489e345e0b7cc1d87e18900841b83f0a49"},
+  {"b48ef6151349e599a840e53ab3258ea7c5b6f01f40f6139d7f1d5d56adda60419b5c0f2f8d3",
+   "7d25db71c8c6839974fce148772150504986fb3084d659387",
+   "e4c310cf03d986726296cbdee4801317de846106e4bc423f6e564459ccfaefba",
+   "db424557d90af6f94e74527b6736e75dae8e7844a154a92817ce922a2c25552d"},
+  {"-9591c210aea24d2b5ab4e5dc4",
+   "10001",
+   "b8c05884a17773e8a32e60637122cd",
+   "73134572719af4a288b59ace199b65"},
+  {"f4041aead24d5af0e",
+   "3",
+   "10000000000000001",
+   "c31156bf7bb74e4c"},
+};
+
+void test_powmod() {
+  uint64_t goodcount = 0, badcount = 0;
+  for (size_t i = 0; i < inputs_powmod.size(); ++i) {
+    BigInt base(inputs_powmod[i][0], 16), exp(inputs_powmod[i][1], 16), mod(inputs_powmod[i][2], 16);
+    BigInt expected(inputs_powmod[i][3], 16);
+    if (powmod(base, exp, mod) != expected) {
+      badcount++;
+      cout << "test_powmod error at #" << i << endl;
+    } else {
+      goodcount++;
+    }
+  }
+
+  // fermat: a^(p-1) = 1 mod p for the mersenne primes 2^127-1 and 2^521-1, and the
+  // small exponents that use the smaller window sizes.
+  uint64_t state = 0x3141;
+  for (uint64_t e : {127ULL, 521ULL}) {
+    BigInt p(1ULL);
+    p <<= e;
+    p -= BigInt(1ULL);
+    MontgomeryContext ctx(p);
+    BigInt a = from_pseudo_random(e / 64, state) % p;
+    const BigInt even(p * BigInt(2ULL));
+    BigInt power(1ULL), power_even(1ULL);
+    bool ok = powmod(a, p - BigInt(1ULL), p) == BigInt(1ULL) && powmod(a, BigInt(), p) == BigInt(1ULL);
+    for (uint64_t k = 1; k < 40 && ok; ++k) {
+      power = power * a % p;
+      power_even = power_even * a % even;
+      ok = powmod(a, BigInt(k), p) == power && powmod(a, BigInt(k), even) == power_even;
+    }
+    ok = ok && ctx.from_montgomery(ctx.mul(ctx.to_montgomery(a), ctx.to_montgomery(a + BigInt(1ULL)))) == a * (a + BigInt(1ULL)) % p;
+    if (!ok) {
+      badcount++;
+      cout << "test_powmod error: fermat 2^" << e << "-1" << endl;
+    } else {
+      goodcount++;
+    }
+  }
+  cout << "powmod test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_barrett() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0xba77e77;
+  std::vector<BigInt> moduli = {BigInt(1ULL), BigInt(2ULL), BigInt(1000000007ULL), BigInt(1ULL) << 192};
+  for (size_t k = 1; k < 12; k += 3) {
+    moduli.push_back(from_pseudo_random(k, state));
+    moduli.push_back(from_pseudo_random(k, state) << 1);
+  }
+  // above BarrettContext::short_product_threshold
+  moduli.push_back(from_pseudo_random(70, state));
+  for (size_t i = 0; i < moduli.size(); ++i) {
+    const BigInt &n = moduli[i];
+    BarrettContext ctx(BigInt(n, true));
+    const size_t k = BigInt(n).get_internal_representation().size();
+    bool ok = true;
+    for (size_t limbs = 0; limbs <= 2*k + 2 && ok; ++limbs) {
+      BigInt x = limbs ? from_pseudo_random(limbs, state) : BigInt();
+      BigInt y = from_pseudo_random(k, state) % n;
+      BigInt r = x % n;
+      BigInt neg_r = r.is_zero() ? r : n - r;
+      ok = ctx.reduce(x) == r && ctx.reduce(BigInt(x, true)) == neg_r && ctx.reduce(n) == BigInt()
+           && ctx.mulmod(r, y) == r * y % n && ctx.mulmod(x, BigInt(y, true)) == ctx.reduce(BigInt(x * y, true))
+           && ctx.addmod(r, y) == (r + y) % n && ctx.addmod(x, x) == (x + x) % n;
+    }
+    if (!ok) {
+      badcount++;
+      cout << "test_barrett error at modulus #" << i << endl;
+    } else {
+      goodcount++;
+    }
+  }
+  cout << "barrett reduction test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_square() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0x5a5a5a5a;
+  // crosses the basecase, Karatsuba, Toom-3 and NTT squaring thresholds
+  const size_t sizes[] = {1, 2, 7, 31, 32, 33, 47, 48, 49, 100, 127, 128, 129, 400, 3072, 3100};
+  for (size_t limbs : sizes) {
+    BigInt x = from_pseudo_random(limbs, state);
+    BigInt copy(x);
+    // x * copy goes through the general multiplication, the limbs are not shared.
+    if (x.square() == x * copy && BigInt(x, true).square() == x * copy) {
+      goodcount++;
+    } else {
+      badcount++;
+      cout << "test_square error at " << limbs << " limbs" << endl;
+    }
+  }
+  for (size_t limbs = 0; limbs < 4; ++limbs) {
+    BigInt x = limbs ? from_pseudo_random(limbs, state) : BigInt();
+    for (bool neg : {false, true}) {
+      BigInt base(x, neg && !x.is_zero());
+      BigInt expected(1ULL);
+      bool ok = true;
+      for (uint64_t e = 0; e < 40 && ok; ++e) {
+        ok = pow(base, e) == expected;
+        expected *= base;
+      }
+      if (ok) {
+        goodcount++;
+      } else {
+        badcount++;
+        cout << "test_square pow error at " << limbs << " limbs" << (neg ? ", negative" : "") << endl;
+      }
+    }
+  }
+  cout << "square/pow test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_parallel_mul() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0x7417ead5;
+  // {na, nb}, nb = 0 squares a. The threaded results are compared with the ones on a
+  // single thread, without BIGINT_THREADS both are the same path.
+  const size_t sizes[][2] = {{8192, 8192}, {8200, 9001}, {20000, 8500}, {12345, 0}, {30000, 0}};
+  for (auto &size : sizes) {
+    BigInt x = from_pseudo_random(size[0], state);
+    BigInt y = size[1] ? from_pseudo_random(size[1], state) : x;
+    BigInt::set_mul_threads(1);
+    BigInt expected = size[1] ? x * y : x.square();
+    bool ok = true;
+    for (unsigned threads : {2, 3, 8}) {
+      BigInt::set_mul_threads(threads);
+      ok = ok && (size[1] ? x * y : x.square()) == expected;
+    }
+    if (ok) {
+      goodcount++;
+    } else {
+      badcount++;
+      cout << "test_parallel_mul error at " << size[0] << "x" << size[1] << " limbs" << endl;
+    }
+  }
+  BigInt::set_mul_threads(0);
+  cout << "parallel multiplication test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_batch() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0xba7c4;
+  const BigIntBatch::simd_level levels[] = {BigIntBatch::simd_scalar, BigIntBatch::simd_avx2, BigIntBatch::simd_avx512,
+                                             BigIntBatch::simd_avx512_ifma};
+  const size_t sizes[] = {1, 2, 4, 9, 16, 33};
+  for (size_t n : sizes) {
+    // not a multiple of the vector width, so the padding gets exercised
+    const size_t count = 21;
+    const BigInt top = BigInt(1ULL) << (64*n);
+    std::vector<BigInt> x(count), y(count);
+    BigIntBatch a(n, count), b(n, count);
+    for (size_t j = 0; j < count; ++j) {
+      x[j] = from_pseudo_random(n, state);
+      // equal numbers and numbers that only differ in the lowest limb for compare
+      y[j] = j % 5 == 0 ? x[j] : j % 5 == 1 ? x[j] + BigInt(1ULL) : from_pseudo_random(n - j % 2, state);
+      y[j] = y[j] % top;
+      a.set(j, x[j]);
+      b.set(j, y[j]);
+    }
+    for (BigIntBatch::simd_level level : levels) {
+      BigIntBatch::set_simd(level);
+      BigIntBatch sum(n + 1, count), diff(n, count), wide_diff(n + 1, count), prod(2*n, count);
+      BigIntBatch low_prod(n, count), sq(2*n + 1, count), in_place(a);
+      BigIntBatch::add(sum, a, b);
+      BigIntBatch::sub(diff, a, b);
+      BigIntBatch::sub(wide_diff, a, b);
+      BigIntBatch::mul(prod, a, b);
+      BigIntBatch::mul(low_prod, a, b);
+      BigIntBatch::mul(sq, a, a);
+      BigIntBatch::add(in_place, in_place, b);
+      std::vector<int> cmp(count);
+      BigIntBatch::compare(&cmp[0], a, b);
+      bool ok = true;
+      for (size_t j = 0; j < count && ok; ++j) {
+        BigInt d = x[j] - y[j];
+        const int expected_cmp = d.is_zero() ? 0 : d.is_neg() ? -1 : 1;
+        if (d.is_neg())
+          d += top;
+        const BigInt wide_d = (x[j] - y[j]).is_neg() ? d + (BigInt(0xffffffffffffffffULL) << (64*n)) : d;
+        ok = sum.get(j) == x[j] + y[j] && diff.get(j) == d && wide_diff.get(j) == wide_d
+             && prod.get(j) == x[j] * y[j] && low_prod.get(j) == x[j] * y[j] % top
+             && sq.get(j) == x[j] * x[j] && in_place.get(j) == (x[j] + y[j]) % top
+             && cmp[j] == expected_cmp;
+      }
+      if (ok) {
+        goodcount++;
+      } else {
+        badcount++;
+        cout << "test_batch error at " << n << " limbs, simd level " << level << endl;
+      }
+    }
+  }
+  BigIntBatch::set_simd(BigIntBatch::detect_simd());
+  cout << "batch test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_kernels() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0xadc5;
+  typedef BigInt::internal_type limb;
+  const BigInt::kernel_level levels[] = {BigInt::kernels_generic, BigInt::kernels_x86_64, BigInt::kernels_bmi2_adx};
+  // every remainder of the four limb blocks, and all-ones limbs for carries that run through
+  const size_t sizes[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 17, 100};
+  for (size_t n : sizes) {
+    for (bool ones : {false, true}) {
+      std::vector<limb> a(n), b(n), m(1);
+      fill_pseudo_random(a, state);
+      fill_pseudo_random(b, state);
+      fill_pseudo_random(m, state);
+      if (ones) {
+        std::fill(a.begin(), a.end(), limb(BigInt::internal_max));
+        for (size_t i = 1; i < n; i += 2)
+          b[i] = BigInt::internal_max;
+        m[0] = BigInt::internal_max;
+      }
+      std::vector<limb> expected, got;
+      for (BigInt::kernel_level level : levels) {
+        BigInt::set_kernels(level);
+        std::vector<limb> out, r(n), t;
+        out.push_back(BigInt::limbs_add_n(&r[0], &a[0], &b[0], n));
+        out.insert(out.end(), r.begin(), r.end());
+        out.push_back(BigInt::limbs_sub_n(&r[0], &a[0], &b[0], n));
+        out.insert(out.end(), r.begin(), r.end());
+        t = a;
+        out.push_back(BigInt::limbs_sub_n(&t[0], &t[0], &b[0], n));
+        out.insert(out.end(), t.begin(), t.end());
+        out.push_back(BigInt::limbs_mul_1(&r[0], &a[0], n, m[0]));
+        out.insert(out.end(), r.begin(), r.end());
+        t = b;
+        out.push_back(BigInt::limbs_addmul_1(&t[0], &a[0], n, m[0]));
+        out.insert(out.end(), t.begin(), t.end());
+        t = b;
+        out.push_back(BigInt::limbs_submul_1(&t[0], &a[0], n, m[0]));
+        out.insert(out.end(), t.begin(), t.end());
+        out.push_back(BigInt::limbs_lshift(&r[0], &a[0], n, 13));
+        out.insert(out.end(), r.begin(), r.end());
+        out.push_back(BigInt::limbs_rshift(&r[0], &a[0], n, 63));
+        out.insert(out.end(), r.begin(), r.end());
+        if (level == BigInt::kernels_generic)
+          expected = out;
+        if (out == expected) {
+          goodcount++;
+        } else {
+          badcount++;
+          cout << "test_kernels error at " << n << " limbs" << (ones ? ", all ones" : "") << ", level " << level << endl;
+        }
+      }
+    }
+  }
+  // whole operations on top of the kernels
+  BigInt x = from_pseudo_random(150, state), y = from_pseudo_random(61, state);
+  BigInt::set_kernels(BigInt::kernels_generic);
+  const BigInt product = x * y, quotient = x / y, sum = x + y, difference = y - x;
+  for (BigInt::kernel_level level : levels) {
+    BigInt::set_kernels(level);
+    if (x * y == product && x / y == quotient && x + y == sum && y - x == difference
+        && ((x << 77) >> 77) == x && (x * y).get_highest_set_bit_position() == product.get_highest_set_bit_position()) {
+      goodcount++;
+    } else {
+      badcount++;
+      cout << "test_kernels error in the operators, level " << level << endl;
+    }
+  }
+  BigInt::set_kernels(BigInt::detect_kernels());
+  cout << "kernel dispatch test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+BigInt euclid_gcd(BigInt a, BigInt b) {
+  a = BigInt(a, false);
+  b = BigInt(b, false);
+  while (!b.is_zero()) {
+    BigInt r = a % b;
+    a = std::move(b);
+    b = std::move(r);
+  }
+  return a;
+}
+
+void test_gcd() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0x9cd;
+  const BigInt one(1ULL);
+  std::vector<std::pair<BigInt, BigInt> > cases;
+  // single limbs, Lehmer with one and two limbs of leading bits, half gcd
+  const size_t sizes[] = {0, 1, 2, 3, 17, 120, 450};
+  for (size_t na : sizes) {
+    for (size_t nb : sizes) {
+      if (na + nb > 600)
+        continue;
+      const BigInt a = from_pseudo_random(na, state), b = from_pseudo_random(nb, state);
+      const BigInt c = from_pseudo_random(na % 5 + 1, state);
+      cases.push_back(std::make_pair(a, b));
+      cases.push_back(std::make_pair(a * c, b * c));
+      cases.push_back(std::make_pair(BigInt(a * c, true), b * c));
+      cases.push_back(std::make_pair(a, BigInt(a, true)));
+    }
+  }
+  // consecutive Fibonacci numbers only have quotients of one
+  BigInt f0, f1(1ULL);
+  for (int i = 0; i < 3000; ++i) {
+    BigInt f2 = f0 + f1;
+    f0 = std::move(f1);
+    f1 = std::move(f2);
+  }
+  cases.push_back(std::make_pair(f1, f0));
+  // quotients too large for the leading bits
+  const BigInt small = from_pseudo_random(3, state);
+  cases.push_back(std::make_pair(from_pseudo_random(40, state) * small + one, small));
+
+  for (const std::pair<BigInt, BigInt> &c : cases) {
+    const BigInt &a = c.first, &b = c.second;
+    BigInt s, t;
+    const BigInt g = gcd(a, b), g2 = extended_gcd(a, b, s, t);
+    bool ok = g == euclid_gcd(a, b) && g2 == g && a*s + b*t == g;
+    // the smallest cofactors, |s| <= |b|/(2g)
+    if (!g.is_zero() && !b.is_zero())
+      ok = ok && !(BigInt(b, false) / g).lt_abs(s + s);
+    if (!a.is_zero() && !b.is_zero())
+      ok = ok && lcm(a, b) == BigInt(a, false) / g * BigInt(b, false);
+    if (ok) {
+      goodcount++;
+    } else {
+      badcount++;
+      cout << "test_gcd error at " << a.get_highest_set_bit_position() << " and "
+           << b.get_highest_set_bit_position() << " bits" << endl;
+    }
+  }
+
+  // inverses, modulo a prime and modulo something that shares a factor
+  const BigInt p("57896044618658097711785492504343953926634992332820282019728792003956564819949");
+  for (size_t n : {1, 4, 9}) {
+    const BigInt x = from_pseudo_random(n, state), inv = modinv(x, p);
+    if ((x * inv) % p == one && modinv(x * BigInt(6ULL), BigInt(9ULL)).is_zero()) {
+      goodcount++;
+    } else {
+      badcount++;
+      cout << "test_gcd error in modinv at " << n << " limbs" << endl;
+    }
+  }
+  if (lcm(BigInt(4ULL), BigInt(6ULL, true)) == BigInt(12ULL) && lcm(BigInt(), BigInt(6ULL)).is_zero()
+      && gcd(BigInt(), BigInt()).is_zero() && modinv(BigInt(3ULL, true), BigInt(7ULL)) == BigInt(2ULL)) {
+    goodcount++;
+  } else {
+    badcount++;
+    cout << "test_gcd error in the small cases" << endl;
+  }
+  cout << "gcd test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+/**
+ * whether iroot(x, k) (isqrt(x) for k = 2) throws std::domain_error.
+ */
+bool throws_domain_error(const BigInt &x, uint64_t k) {
+  try {
+    if (k == 2)
+      isqrt(x);
+    else
+      iroot(x, k);
+  } catch (const std::domain_error &) {
+    return true;
+  }
+  return false;
+}
+
+void test_roots() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0x5157;
+  const BigInt one(1ULL);
+  // the limb base case, one and several levels of Newton steps
+  const size_t sizes[] = {0, 1, 2, 3, 8, 40, 300};
+  for (size_t n : sizes) {
+    for (int round = 0; round < 4; ++round) {
+      const BigInt x = from_pseudo_random(n, state) >> (round * 17);
+      BigInt rem;
+      const BigInt s = isqrt_rem(x, rem);
+      bool ok = !rem.is_neg() && s.square() + rem == x && x.lt_abs((s + one).square());
+      for (uint64_t k : {3, 5, 12, 200}) {
+        const BigInt r = iroot(x, k);
+        ok = ok && !x.lt_abs(pow(r, k)) && x.lt_abs(pow(r + one, k));
+      }
+      // odd roots keep the sign, even roots of negative numbers don't exist
+      ok = ok && iroot(BigInt() - x, 7) == BigInt() - iroot(x, 7);
+      ok = ok && (x.is_zero() || (throws_domain_error(BigInt() - x, 4) && throws_domain_error(BigInt() - x, 200)
+                                  && throws_domain_error(BigInt() - x, 2)));
+      if (ok) {
+        goodcount++;
+      } else {
+        badcount++;
+        cout << "test_roots error at " << x.get_highest_set_bit_position() << " bits" << endl;
+      }
+    }
+  }
+
+  // exact powers, and their neighbours which aren't
+  for (size_t n : {1, 2, 5, 20}) {
+    for (uint64_t e : {2, 3, 6, 7}) {
+      const BigInt b = from_pseudo_random(n, state) + one;
+      const BigInt x = pow(b, e);
+      BigInt root;
+      uint64_t k = 0;
+      bool ok = iroot(x, e) == b && iroot(x - one, e) == b - one;
+      ok = ok && is_perfect_power(x, root, k) && k % e == 0 && pow(root, k) == x;
+      ok = ok && !is_perfect_power(x + one) && !is_perfect_power(x - one);
+      ok = ok && is_perfect_square(x) == (e % 2 == 0) && !is_perfect_square(x + one);
+      if (ok) {
+        goodcount++;
+      } else {
+        badcount++;
+        cout << "test_roots error in the perfect powers, " << n << " limbs, exponent " << e << endl;
+      }
+    }
+  }
+
+  // small numbers against counting
+  bool small_ok = true;
+  for (uint64_t v = 0; v < 300; ++v) {
+    uint64_t s = 0, c = 0;
+    while ((s + 1) * (s + 1) <= v)
+      s++;
+    while ((c + 1) * (c + 1) * (c + 1) <= v)
+      c++;
+    bool power = v < 2;
+    for (uint64_t b = 2; b * b <= v; ++b) {
+      uint64_t t = b * b;
+      while (t < v)
+        t *= b;
+      power = power || t == v;
+    }
+    small_ok = small_ok && isqrt(BigInt(v)) == BigInt(s) && iroot(BigInt(v), 3) == BigInt(c)
+        && is_perfect_square(BigInt(v)) == (s * s == v) && is_perfect_power(BigInt(v)) == power;
+  }
+  BigInt root;
+  uint64_t k = 0;
+  small_ok = small_ok && is_perfect_power(pow(BigInt(36ULL), 6), root, k) && root == BigInt(6ULL) && k == 12;
+  small_ok = small_ok && is_perfect_power(BigInt() - pow(BigInt(7ULL), 15), root, k) && root == BigInt(7ULL, true) && k == 15;
+  small_ok = small_ok && throws_domain_error(BigInt(4ULL, true), 64) && throws_domain_error(BigInt(1ULL, true), 4)
+      && iroot(BigInt(1ULL, true), 3) == BigInt(1ULL, true) && iroot(BigInt(0ULL, true), 4).is_zero();
+  small_ok = small_ok && !is_perfect_power(BigInt() - pow(BigInt(7ULL), 2)) && !is_perfect_square(BigInt(4ULL, true));
+  if (small_ok) {
+    goodcount++;
+  } else {
+    badcount++;
+    cout << "test_roots error in the small numbers" << endl;
+  }
+  cout << "roots test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_bitwise() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0xb175;
+  const BigInt one(1ULL), two(2ULL);
+  // identities of the two's complement, on numbers of different lengths and signs
+  const size_t sizes[] = {0, 1, 2, 5, 33};
+  for (size_t na : sizes) {
+    for (size_t nb : sizes) {
+      for (int signs = 0; signs < 4; ++signs) {
+        const BigInt a(from_pseudo_random(na, state), (signs & 1) && na), b(from_pseudo_random(nb, state), (signs & 2) && nb);
+        const BigInt both = a & b, either = a | b, one_of = a ^ b;
+        BigInt c(a);
+        c ^= b;
+        bool ok = either - both == one_of && a + b == one_of + both * two && c == one_of;
+        ok = ok && ~~a == a && (a & ~a).is_zero() && (a | ~a) == BigInt(1ULL, true);
+        ok = ok && either == ~(~a & ~b) && (a ^ b ^ b) == a;
+        ok = ok && both.is_neg() == (a.is_neg() && b.is_neg()) && either.is_neg() == (a.is_neg() || b.is_neg());
+        const uint64_t pos = (na + nb) * 29 % 150;
+        BigInt d(a);
+        d.set_bit(pos);
+        ok = ok && d.test_bit(pos) && d == (a | (one << pos));
+        d.set_bit(pos, false);
+        ok = ok && !d.test_bit(pos) && d == (a & ~(one << pos));
+        if (ok) {
+          goodcount++;
+        } else {
+          badcount++;
+          cout << "test_bitwise error at " << na << " and " << nb << " limbs, signs " << signs << endl;
+        }
+      }
+    }
+  }
+
+  // power of two divisors against the general division
+  for (uint64_t k : {0, 1, 63, 64, 65, 200}) {
+    for (bool negative : {false, true}) {
+      const BigInt a(from_pseudo_random(5, state), negative), d = one << k;
+      BigInt q, r;
+      q = a.div_abs(d, r);
+      q = BigInt(q, negative && !q.is_zero());
+      if (a / d == q && a % d == r && a / BigInt(d, true) == BigInt() - q && a % BigInt(d, true) == r) {
+        goodcount++;
+      } else {
+        badcount++;
+        cout << "test_bitwise error dividing by 2^" << k << (negative ? ", negative" : "") << endl;
+      }
+    }
+  }
+
+  const BigInt x = (BigInt(0xf0ULL) << 128) + BigInt(0x10ULL);
+  if (x.popcount() == 5 && x.count_trailing_zeros() == 4 && BigInt().count_trailing_zeros() == 0
+      && (BigInt(12ULL) & BigInt(10ULL, true)) == BigInt(4ULL) && (BigInt(12ULL) | BigInt(10ULL, true)) == BigInt(2ULL, true)
+      && (BigInt(12ULL, true) ^ BigInt(10ULL, true)) == BigInt(2ULL) && ~BigInt() == BigInt(1ULL, true)
+      && BigInt(8ULL, true).test_bit(3) && !BigInt(8ULL, true).test_bit(2) && BigInt(8ULL, true).test_bit(1000)) {
+    goodcount++;
+  } else {
+    badcount++;
+    cout << "test_bitwise error in the small cases" << endl;
+  }
+  cout << "bitwise test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+void test_serialization() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0x5e71;
+  const BigInt::endianness orders[] = {BigInt::little_endian, BigInt::big_endian};
+  // every layout against the bytes taken off the number one at a time
+  for (size_t limbs : {0, 1, 2, 3, 7}) {
+    for (uint64_t drop : {0, 8, 28}) {
+      const BigInt a = from_pseudo_random(limbs, state) >> drop;
+      vector<uint8_t> le; // least significant byte first
+      for (BigInt t(a); !t.is_zero(); t >>= 8)
+        le.push_back(uint8_t(t.get_bits_at_pos(0, 8)));
+      for (size_t word_size : {1, 2, 3, 4, 8, 16}) {
+        const size_t words = (le.size() + word_size - 1) / word_size;
+        for (BigInt::endianness word_order : orders) {
+          for (BigInt::endianness byte_order : orders) {
+            vector<uint8_t> expected(words * word_size);
+            for (size_t i = 0; i < expected.size(); ++i) {
+              const size_t word = i / word_size, byte = i % word_size;
+              expected[(word_order == BigInt::little_endian ? word : words - 1 - word) * word_size
+                       + (byte_order == BigInt::little_endian ? byte : word_size - 1 - byte)] = i < le.size() ? le[i] : 0;
+            }
+            const vector<uint8_t> out = a.export_bytes(word_order, word_size, byte_order);
+            // an extra word of leading zeros doesn't change the number
+            vector<uint8_t> padded(expected);
+            padded.insert(word_order == BigInt::little_endian ? padded.end() : padded.begin(), word_size, 0);
+            if (out == expected && a.export_size(word_size) == out.size()
+                && BigInt::import_bytes(out.data(), out.size(), word_order, word_size, byte_order) == a
+                && BigInt::import_bytes(padded.data(), padded.size(), word_order, word_size, byte_order) == a) {
+              goodcount++;
+            } else {
+              badcount++;
+              cout << "test_serialization error at " << limbs << " limbs, word size " << word_size
+                   << ", orders " << word_order << byte_order << endl;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  const uint8_t bytes[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+  const BigInt x = BigInt::import_bytes(bytes, 9), y = BigInt::import_bytes(bytes, 9, BigInt::little_endian);
+  const BigInt::limb_span view = x.get_limbs();
+  BigInt::data_collection_type buffer;
+  buffer.push_back(0x0203040506070809ULL);
+  buffer.push_back(1);
+  buffer.push_back(0);
+  buffer.push_back(0);
+  const BigInt adopted(std::move(buffer), true);
+  if (view.size() == 2 && view[0] == 0x0203040506070809ULL && view[1] == 1 && view.end() - view.begin() == 2
+      && y.get_limbs()[0] == 0x0807060504030201ULL && y.get_limbs()[1] == 9
+      && adopted.is_neg() && adopted.get_limbs().size() == 2 && adopted == BigInt() - x
+      && BigInt().get_limbs().empty() && BigInt().export_bytes().empty() && BigInt::import_bytes(bytes, 0).is_zero()
+      && !BigInt(BigInt::data_collection_type(), true).is_neg()) {
+    goodcount++;
+  } else {
+    badcount++;
+    cout << "test_serialization error in the small cases" << endl;
+  }
+  cout << "serialization test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
+template <size_t Bits>
+bool check_fixed(uint64_t &state) {
+  const BigInt top = BigInt(1ULL) << Bits;
+  for (int round = 0; round < 20; ++round) {
+    BigInt x = from_pseudo_random(FixedBigInt<Bits>::limbs, state);
+    BigInt y = round % 4 == 0 ? x : from_pseudo_random(round % FixedBigInt<Bits>::limbs + 1, state);
+    FixedBigInt<Bits> a(x), b(y);
+    const size_t shift = (round * 37) % (Bits + 70);
+    BigInt d = x - y;
+    if (d.is_neg())
+      d += top;
+    const int cmp = (x - y).is_zero() ? 0 : (x - y).is_neg() ? -1 : 1;
+    if (a.to_bigint() != x || (a + b).to_bigint() != (x + y) % top || (a - b).to_bigint() != d
+        || (a * b).to_bigint() != x * y % top || mul_wide(a, b).to_bigint() != x * y
+        || (a << shift).to_bigint() != (x << shift) % top || (a >> shift).to_bigint() != x >> shift
+        || FixedBigInt<Bits>::compare(a, b) != cmp || (a < b) != (cmp < 0) || (a == b) != (cmp == 0)
+        || FixedBigInt<Bits>::from_hex(a.toString(16).c_str()) != a
+        || FixedBigInt<Bits>(x + top) != a)
+      return false;
+  }
+  return true;
+}
+
+// containers move BigInts instead of copying them only if the move can't throw
+static_assert(std::is_nothrow_move_constructible<BigInt>::value && std::is_nothrow_move_assignable<BigInt>::value, "");
+
+#if __cplusplus >= 201402L
+// everything but the BigInt conversions works at compile time
+constexpr FixedBigInt<256> p25519 = (FixedBigInt<256>(1) << 255) - FixedBigInt<256>(19);
+static_assert(p25519 == FixedBigInt<256>::from_hex("7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffed"), "");
+static_assert(mul_wide(p25519, p25519) >> 256 == (FixedBigInt<512>(1) << 254) - FixedBigInt<512>(19), "");
+static_assert((p25519 + FixedBigInt<256>(19)) * FixedBigInt<256>(2) == FixedBigInt<256>(), "");
+#endif
+
+void test_fixed() {
+  uint64_t goodcount = 0, badcount = 0;
+  uint64_t state = 0xf12ed;
+  const bool results[] = {check_fixed<64>(state), check_fixed<256>(state), check_fixed<512>(state),
+                          check_fixed<4096>(state)};
+  for (bool ok : results) {
+    if (ok) {
+      goodcount++;
+    } else {
+      badcount++;
+      cout << "test_fixed error at size #" << (goodcount + badcount) << endl;
+    }
+  }
+  cout << "fixed size test: " << (goodcount + badcount) << " total, " << badcount << " failed." << endl;
+}
+
 int main() {
   test_encoding();
   test_shifts();
   test_adds();
   test_add_bits_at_pos();
   test_mul();
+  test_mul_large();
   test_sub();
   test_div();
+  test_div_large();
+  test_divmod_limb();
   test_strrep();
+  test_strrep_large();
+  test_strrep_pow2();
+  test_inline_storage();
+  test_scratch();
+  test_signed_ops();
+  test_carry_chains();
+  test_shift_operators();
+  test_powmod();
+  test_barrett();
+  test_square();
+  test_parallel_mul();
+  test_batch();
+  test_fixed();
+  test_kernels();
+  test_gcd();
+  test_roots();
+  test_bitwise();
+  test_serialization();
 }
 
@@ -5,6 +5,426 @@
 #include <iostream>
 #include <iomanip>
 #include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <stdexcept>
+#include <new>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) && !defined(__EMSCRIPTEN__)
+// x86-64 with GNU inline assembly. The kernels for instruction set extensions are compiled
+// regardless of the target flags and picked at runtime.
+#define BIGINT_X86
+#define BIGINT_TARGET(arch) __attribute__((target(arch)))
+#include <cpuid.h>
+#endif
+#if defined(__clang__) && defined(__has_builtin)
+#if __has_builtin(__builtin_addcll)
+#define BIGINT_HAS_ADDCLL
+#endif
+#endif
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// the limbs in memory are the number as little endian bytes, import and export copy them.
+#define BIGINT_LITTLE_ENDIAN
+#endif
+
+/**
+ * constexpr for functions that need C++14 (loops, several statements, changing members).
+ * They are plain inline functions in C++11 builds.
+ */
+#if __cplusplus >= 201402L
+#define BIGINT_CONSTEXPR14 constexpr
+#else
+#define BIGINT_CONSTEXPR14 inline
+#endif
+
+/**
+ * unrolls the loop that follows, up to 16 iterations (the limbs of a 1024 bit number).
+ */
+#if defined(__clang__)
+#define BIGINT_UNROLL _Pragma("unroll 16")
+#elif defined(__GNUC__) && __GNUC__ >= 8
+#define BIGINT_UNROLL _Pragma("GCC unroll 16")
+#else
+#define BIGINT_UNROLL
+#endif
+
+#ifndef BIGINT_INLINE_LIMBS
+/**
+ * number of limbs a BigInt stores without a heap allocation.
+ */
+#define BIGINT_INLINE_LIMBS 4
+#endif
+
+#ifndef BIGINT_ALLOCATOR
+/**
+ * allocator for the limbs of numbers that don't fit into the inline buffer. Can be
+ * defined to a pool or arena allocator before including this file.
+ */
+#define BIGINT_ALLOCATOR std::allocator<uint64_t>
+#endif
+
+/**
+ * define BIGINT_THREADS (and build with -pthread) to let the multiplication of very large
+ * numbers use more than one thread, see BigInt::set_mul_threads. Emscripten builds without
+ * thread support always stay on the calling thread.
+ */
+#if defined(BIGINT_THREADS) && defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#undef BIGINT_THREADS
+#endif
+#ifdef BIGINT_THREADS
+#include <thread>
+#include <atomic>
+#include <system_error>
+#endif
+
+/**
+ * A vector-like container that keeps up to N elements in the object itself and only
+ * allocates from Alloc when it grows beyond that. Only the subset of the std::vector
+ * interface that BigInt needs is provided.
+ *
+ * T must be trivially copyable, elements are moved around with memcpy/memmove and are not
+ * initialized unless a value is given.
+ */
+template <typename T, size_t N, typename Alloc = std::allocator<T> >
+class SmallVector : private Alloc {
+  public:
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef T* iterator;
+  typedef const T* const_iterator;
+  typedef Alloc allocator_type;
+
+  private:
+  typedef std::allocator_traits<Alloc> alloc_traits;
+
+  T *m_ptr;
+  size_t m_size;
+  size_t m_capacity;
+  T m_inline[N];
+
+  bool is_inline() const {
+    return m_ptr == m_inline;
+  }
+
+  /**
+   * moves the elements to a buffer of at least new_capacity elements.
+   */
+  void grow(size_t new_capacity) {
+    if (new_capacity < 2*m_capacity)
+      new_capacity = 2*m_capacity;
+    T *buffer = alloc_traits::allocate(allocator(), new_capacity);
+    if (m_size)
+      std::memcpy(buffer, m_ptr, m_size * sizeof(T));
+    if (!is_inline())
+      alloc_traits::deallocate(allocator(), m_ptr, m_capacity);
+    m_ptr = buffer;
+    m_capacity = new_capacity;
+  }
+
+  void release() {
+    if (!is_inline())
+      alloc_traits::deallocate(allocator(), m_ptr, m_capacity);
+    m_ptr = m_inline;
+    m_capacity = N;
+    m_size = 0;
+  }
+
+  Alloc& allocator() { return *this; }
+  const Alloc& allocator() const { return *this; }
+
+  /**
+   * for copy assignment: an allocator that propagates replaces ours, our buffer goes back
+   * to the one it came from first.
+   */
+  void copy_allocator(const SmallVector &other, std::true_type) {
+    if (!(allocator() == other.allocator())) {
+      release();
+      allocator() = other.allocator();
+    }
+  }
+
+  void copy_allocator(const SmallVector &, std::false_type) {}
+
+  /**
+   * the elements of other into our buffer, which grows from our allocator if needed.
+   */
+  void copy_elements(const SmallVector &other) {
+    if (other.m_size > m_capacity) {
+      m_size = 0;
+      grow(other.m_size);
+    }
+    if (other.m_size)
+      std::memcpy(m_ptr, other.m_ptr, other.m_size * sizeof(T));
+    m_size = other.m_size;
+  }
+
+  public:
+  SmallVector() : m_ptr(m_inline), m_size(0), m_capacity(N) {}
+
+  explicit SmallVector(const Alloc &alloc) : Alloc(alloc), m_ptr(m_inline), m_size(0), m_capacity(N) {}
+
+  explicit SmallVector(size_t n, const T &value = T()) : m_ptr(m_inline), m_size(0), m_capacity(N) {
+    resize(n, value);
+  }
+
+  template <typename InputIt>
+  SmallVector(InputIt first, InputIt last,
+              typename std::enable_if<!std::is_integral<InputIt>::value>::type* = 0)
+    : m_ptr(m_inline), m_size(0), m_capacity(N) {
+    for (; first != last; ++first)
+      push_back(*first);
+  }
+
+  SmallVector(const SmallVector &other)
+    : Alloc(alloc_traits::select_on_container_copy_construction(other.get_allocator())),
+      m_ptr(m_inline), m_size(0), m_capacity(N) {
+    copy_elements(other);
+  }
+
+  SmallVector(SmallVector &&other) noexcept
+    : Alloc(std::move(other.allocator())), m_ptr(m_inline), m_size(0), m_capacity(N) {
+    *this = std::move(other);
+  }
+
+  ~SmallVector() {
+    release();
+  }
+
+  SmallVector& operator=(const SmallVector &other) {
+    if (this == &other)
+      return *this;
+    copy_allocator(other, typename alloc_traits::propagate_on_container_copy_assignment());
+    copy_elements(other);
+    return *this;
+  }
+
+  /**
+   * takes over the heap buffer of other, inline data (or data from an allocator that
+   * can't free our buffers) is copied. Inline data fits into our capacity, so only the
+   * copy between unequal allocators can allocate, and a throw there terminates. With
+   * std::allocator that can't happen.
+   */
+  SmallVector& operator=(SmallVector &&other) noexcept {
+    if (this == &other)
+      return *this;
+    if (other.is_inline() || !(allocator() == other.allocator())) {
+      copy_elements(other);
+      other.m_size = 0;
+      return *this;
+    }
+    release();
+    m_ptr = other.m_ptr;
+    m_size = other.m_size;
+    m_capacity = other.m_capacity;
+    other.m_ptr = other.m_inline;
+    other.m_size = 0;
+    other.m_capacity = N;
+    return *this;
+  }
+
+  Alloc get_allocator() const { return *this; }
+
+  size_t size() const { return m_size; }
+  size_t capacity() const { return m_capacity; }
+  bool empty() const { return m_size == 0; }
+
+  T* data() { return m_ptr; }
+  const T* data() const { return m_ptr; }
+  T& operator[](size_t i) { return m_ptr[i]; }
+  const T& operator[](size_t i) const { return m_ptr[i]; }
+  T& back() { return m_ptr[m_size-1]; }
+  const T& back() const { return m_ptr[m_size-1]; }
+
+  iterator begin() { return m_ptr; }
+  iterator end() { return m_ptr + m_size; }
+  const_iterator begin() const { return m_ptr; }
+  const_iterator end() const { return m_ptr + m_size; }
+
+  void reserve(size_t n) {
+    if (n > m_capacity)
+      grow(n);
+  }
+
+  void push_back(const T &value) {
+    // value might live in this container
+    const T copy = value;
+    if (m_size == m_capacity)
+      grow(m_size + 1);
+    m_ptr[m_size++] = copy;
+  }
+
+  void pop_back() {
+    m_size--;
+  }
+
+  void resize(size_t n, const T &value = T()) {
+    const T copy = value;
+    if (n > m_capacity)
+      grow(n);
+    for (size_t i = m_size; i < n; ++i)
+      m_ptr[i] = copy;
+    m_size = n;
+  }
+
+  void clear() {
+    m_size = 0;
+  }
+
+  iterator erase(iterator first, iterator last) {
+    if (first != last) {
+      std::memmove(first, last, (end() - last) * sizeof(T));
+      m_size -= last - first;
+    }
+    return first;
+  }
+
+  iterator insert(iterator pos, size_t count, const T &value) {
+    const size_t idx = pos - m_ptr;
+    const T copy = value;
+    if (m_size + count > m_capacity)
+      grow(m_size + count);
+    std::memmove(m_ptr + idx + count, m_ptr + idx, (m_size - idx) * sizeof(T));
+    for (size_t i = 0; i < count; ++i)
+      m_ptr[idx + i] = copy;
+    m_size += count;
+    return m_ptr + idx;
+  }
+
+  bool operator==(const SmallVector &other) const {
+    return m_size == other.m_size && std::equal(begin(), end(), other.begin());
+  }
+
+  bool operator!=(const SmallVector &other) const {
+    return !(*this == other);
+  }
+};
+
+/**
+ * Per-thread stack of scratch memory for the temporaries of the arithmetic kernels.
+ *
+ * Memory is handed out by bumping a pointer and given back in LIFO order by ScratchFrame,
+ * so the nested temporaries of recursive algorithms don't go through the global allocator.
+ * Blocks are kept after use, once the arena has grown to the working set of a computation,
+ * repeating it doesn't allocate at all.
+ */
+class ScratchArena {
+  friend class ScratchFrame;
+
+  struct block {
+    char *data;
+    size_t size;
+  };
+  std::vector<block> m_blocks;
+  // block that is currently allocated from, and the bytes used in it
+  size_t m_block;
+  size_t m_used;
+
+  ScratchArena() : m_block(0), m_used(0) {}
+  ScratchArena(const ScratchArena &) = delete;
+  ScratchArena& operator=(const ScratchArena &) = delete;
+
+  void* allocate(size_t bytes) {
+    // keep everything aligned for the widest type the kernels use
+    bytes = (bytes + alignment - 1) & ~(alignment - 1);
+    for (; m_block < m_blocks.size(); ++m_block, m_used = 0) {
+      if (m_blocks[m_block].size - m_used >= bytes) {
+        void *p = m_blocks[m_block].data + m_used;
+        m_used += bytes;
+        return p;
+      }
+    }
+    size_t size = std::max(bytes, size_t(min_block_size));
+    if (m_blocks.size())
+      size = std::max(size, 2*m_blocks.back().size);
+    m_blocks.reserve(m_blocks.size() + 1);
+    block b = { static_cast<char*>(::operator new(size)), size };
+    m_blocks.push_back(b);
+    m_block = m_blocks.size() - 1;
+    m_used = bytes;
+    return b.data;
+  }
+
+  public:
+  static const size_t alignment = 16;
+  static const size_t min_block_size = 64 * 1024;
+
+  ~ScratchArena() {
+    release();
+  }
+
+  /**
+   * the arena of the calling thread.
+   */
+  static ScratchArena& local() {
+    static thread_local ScratchArena arena;
+    return arena;
+  }
+
+  /**
+   * bytes held by the arena, whether in use or not.
+   */
+  size_t reserved() const {
+    size_t total = 0;
+    for (size_t i = 0; i < m_blocks.size(); ++i)
+      total += m_blocks[i].size;
+    return total;
+  }
+
+  /**
+   * gives all blocks back to the global allocator. Must not be called while a ScratchFrame
+   * of this thread is alive.
+   */
+  void release() {
+    for (size_t i = 0; i < m_blocks.size(); ++i)
+      ::operator delete(m_blocks[i].data);
+    m_blocks.clear();
+    m_block = 0;
+    m_used = 0;
+  }
+};
+
+/**
+ * scoped allocation from the thread's ScratchArena, everything allocated through a frame
+ * is released when it goes out of scope. Frames must be destroyed in reverse order of
+ * construction, which is what happens naturally with local variables.
+ */
+class ScratchFrame {
+  ScratchArena &m_arena;
+  size_t m_block;
+  size_t m_used;
+
+  public:
+  ScratchFrame() : m_arena(ScratchArena::local()), m_block(m_arena.m_block), m_used(m_arena.m_used) {}
+  ScratchFrame(const ScratchFrame &) = delete;
+  ScratchFrame& operator=(const ScratchFrame &) = delete;
+
+  ~ScratchFrame() {
+    m_arena.m_block = m_block;
+    m_arena.m_used = m_used;
+  }
+
+  /**
+   * uninitialized room for n objects of the trivial type T.
+   */
+  template <typename T>
+  T* alloc(size_t n) {
+    return static_cast<T*>(m_arena.allocate(n * sizeof(T)));
+  }
+};
+
+class MontgomeryContext;
+class BarrettContext;
+class BigIntBatch;
+template <size_t Bits> class FixedBigInt;
 
 /**
  * A toy big integer implementation.
@@ -13,6 +433,14 @@
  *
  */
 class BigInt {
+  friend class MontgomeryContext;
+  friend class BarrettContext;
+  friend class BigIntBatch;
+  template <size_t Bits> friend class FixedBigInt;
+  friend BigInt gcd(const BigInt &a, const BigInt &b);
+  friend BigInt extended_gcd(const BigInt &a, const BigInt &b, BigInt &s, BigInt &t);
+  friend bool is_perfect_square(const BigInt &x);
+  friend bool is_perfect_power(const BigInt &x, BigInt &root, uint64_t &k);
 
   public:
   typedef uint64_t internal_type;
@@ -22,12 +450,60 @@ class BigInt {
   // all bits set
   static const internal_type internal_max = ~((internal_type)0);
 
+  // operand sizes (in limbs) from which on operator* switches to the subquadratic algorithms.
+  static const size_t mul_karatsuba_threshold = 32;
+  static const size_t mul_toom3_threshold = 128;
+  static const size_t mul_ntt_threshold = 3072;
+  // same for squares, which have cheaper schoolbook and Karatsuba steps of their own.
+  static const size_t sqr_karatsuba_threshold = 32;
+  // divisor and quotient size (in limbs) from which on division uses a newton reciprocal.
+  static const size_t div_newton_threshold = 1200;
+  // smaller operand size (in limbs) from which on a multiplication is spread over the
+  // threads set with set_mul_threads.
+  static const size_t mul_parallel_threshold = 8192;
+  // operand size (in limbs) from which on gcd works with half-gcd matrices.
+  static const size_t gcd_hgcd_threshold = 400;
+  // operand size (in limbs) from which on Lehmer's gcd looks at two limbs of leading bits.
+  static const size_t gcd_lehmer2_threshold = 100;
+  // number size (in limbs) from which on toString splits the number by powers of the radix.
+  static const size_t tostring_dc_threshold = 30;
+  // same for parsing, counted in limbs worth of digits.
+  static const size_t parse_dc_threshold = 30;
+
+  /**
+   * it is possible to use a different datatype as well, such as std::vector or deque.
+   * The default keeps up to BIGINT_INLINE_LIMBS limbs inside the object, so small numbers
+   * don't touch the heap at all.
+   *
+   * The arithmetic works on &m_data[0], so the container must store its elements contiguously.
+   */
+  typedef SmallVector<internal_type, BIGINT_INLINE_LIMBS, BIGINT_ALLOCATOR> data_collection_type;
+
   /**
-   * it is possible to use a different datatype as well, such as deque, to address
-   * performance problems when using shifts a lot. However, this slows down other
-   * operations.
+   * a read-only view of the limbs of a number (least significant first, without the sign),
+   * see get_limbs. It doesn't own them and is only valid until the number changes.
    */
-  typedef std::vector<internal_type> data_collection_type;
+  class limb_span {
+    public:
+    typedef const internal_type* iterator;
+
+    limb_span(const internal_type *data, size_t size) : m_ptr(data), m_size(size) {}
+
+    const internal_type* data() const { return m_ptr; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const internal_type& operator[](size_t i) const { return m_ptr[i]; }
+    iterator begin() const { return m_ptr; }
+    iterator end() const { return m_ptr + m_size; }
+
+    private:
+    const internal_type *m_ptr;
+    size_t m_size;
+  };
+
+  // byte and word orders for import_bytes and export_bytes
+  enum endianness { little_endian, big_endian };
+
   private:
   /**
    * Internal data member. This must always be an unsigned type, and needs to have at least 2
@@ -49,6 +525,24 @@ class BigInt {
   BigInt(const BigInt &) = default;
   BigInt& operator=(const BigInt & other) = default;
 
+  /**
+   * move constructor and assignment take over the limbs of other, which is left as zero.
+   */
+  BigInt(BigInt &&other) noexcept : m_data(std::move(other.m_data)), neg(other.neg) {
+    other.m_data.clear();
+    other.neg = false;
+  }
+
+  BigInt& operator=(BigInt &&other) noexcept {
+    m_data = std::move(other.m_data);
+    neg = other.neg;
+    if (this != &other) {
+      other.m_data.clear();
+      other.neg = false;
+    }
+    return *this;
+  }
+
   /**
    * Initializes a BigInt with zero.
    */
@@ -63,6 +557,15 @@ class BigInt {
     neg = neg_override;
   }
 
+  /**
+   * takes over the limbs (least significant first) without copying them. Zero limbs at the
+   * top are dropped.
+   */
+  explicit BigInt(data_collection_type &&limbs, bool negative = false) : m_data(std::move(limbs)) {
+    neg = negative;
+    remove_empty_registers();
+  }
+
   /**
    * Initialize from a standard integer type. Note that the value
    * will be treated as unsigned.
@@ -76,43 +579,149 @@ class BigInt {
 
 
   /**
-   * Initialize from a string. The string is not checked for correctness. String parsing
-   * is done RTL and stops at the first '-' or at the beginning of the string.
+   * Initialize from a string. The string is not checked for correctness. Everything up to
+   * and including the last '-' is skipped, the number is negative if there was one.
    *
    * Radix can be anything between 2-36. Supported characters are [0-9a-zA-Z].
    */
-  BigInt(const std::string input, uint8_t radix=10) {
-    // BitMath objects are used to calculate the positions where the bits for each digit are
-    // placed. current_multiplier is multiplied by radix in each iteration with the radix.
-    neg = false;
-    BigInt radix_b(radix);
-    BigInt current_multiplier(1ULL);
-
-    for (ssize_t r_pos = input.size() - 1; r_pos >= 0; --r_pos) {
-      uint8_t cval_i = 0;
-      char current_char = input[r_pos];
-      if (current_char == '-') {
-        neg = true;
-        break;
-      }
-      // calculate hex offsets
-      if (radix <= 10 || (current_char >= '0' && current_char <= '9')) {
-        cval_i = current_char - '0';
-      } else {
-        if (current_char >= 'A' && current_char <= 'Z') {
-          cval_i = 10+(current_char-'A');
-        } else {
-          cval_i = 10+(current_char-'a');
-        }
-      }
-      BigInt cval(cval_i);
-      cval *= current_multiplier;
-      add_abs(cval);
+  BigInt(const std::string &input, uint8_t radix=10) {
+    size_t start = input.rfind('-');
+    bool negative = start != std::string::npos;
+    start = negative ? start + 1 : 0;
+
+    std::vector<BigInt> powers;
+    *this = parse_digits(input.data() + start, input.size() - start, radix, powers);
+    neg = negative && !is_zero();
+  }
+
+  /**
+   * value of a single digit character.
+   */
+  static uint8_t digit_value(char c, uint8_t radix) {
+    if (radix <= 10 || (c >= '0' && c <= '9'))
+      return c - '0';
+    if (c >= 'A' && c <= 'Z')
+      return 10 + (c - 'A');
+    return 10 + (c - 'a');
+  }
+
+  /**
+   * value of 16 hex digits, the first one being the most significant.
+   */
+  static internal_type parse_hex_limb(const char *p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // eight characters at a time: '0'-'9' are 0x30-0x39, 'A'-'F' 0x41-0x46 and 'a'-'f'
+    // 0x61-0x66, so the low nibble plus 9 for letters (bit 6 set) is the digit value.
+    // Then the nibbles are merged pairwise; the first character sits in the lowest byte.
+    internal_type result = 0;
+    for (int half = 0; half < 2; ++half) {
+      uint64_t x;
+      std::memcpy(&x, p + 8*half, 8);
+      x = (x & 0x0f0f0f0f0f0f0f0fULL) + 9 * ((x >> 6) & 0x0101010101010101ULL);
+      x = ((x & 0x000f000f000f000fULL) << 4) | ((x & 0x0f000f000f000f00ULL) >> 8);
+      x = ((x & 0x000000ff000000ffULL) << 8) | ((x & 0x00ff000000ff0000ULL) >> 16);
+      x = ((x & 0xffffULL) << 16) | ((x >> 32) & 0xffffULL);
+      result = (result << 32) | x;
+    }
+    return result;
+#else
+    internal_type result = 0;
+    for (int i = 0; i < 16; ++i)
+      result = (result << 4) | digit_value(p[i], 16);
+    return result;
+#endif
+  }
 
-      current_multiplier *= radix_b;
+  /**
+   * parses digits of a power of two radix by placing their bits directly into the limbs,
+   * starting at the least significant digit.
+   */
+  static BigInt parse_digits_pow2(const char *p, size_t len, uint8_t radix) {
+    uint8_t bits = 0;
+    while ((1 << bits) < radix)
+      bits++;
+
+    BigInt result;
+    result.m_data.resize(((uint64_t)len * bits + internal_bitlen - 1) / internal_bitlen);
+    if (result.m_data.empty())
+      return result;
+
+    if (radix == 16) {
+      // whole limbs first, then the remaining most significant digits.
+      size_t i = 0;
+      for (; 16*(i+1) <= len; ++i)
+        result.m_data[i] = parse_hex_limb(p + len - 16*(i+1));
+      internal_type top = 0;
+      for (size_t j = 0; j < len - 16*i; ++j)
+        top = (top << 4) | digit_value(p[j], 16);
+      if (i < result.m_data.size())
+        result.m_data[i] = top;
+    } else {
+      uint64_t pos = 0;
+      for (size_t i = len; i > 0; --i, pos += bits) {
+        internal_type value = digit_value(p[i-1], radix);
+        const uint64_t idx = pos / internal_bitlen;
+        const uint8_t shift = pos % internal_bitlen;
+        result.m_data[idx] |= value << shift;
+        if (shift + bits > internal_bitlen)
+          result.m_data[idx+1] |= value >> (internal_bitlen - shift);
+      }
     }
+    result.remove_empty_registers();
+    return result;
   }
 
+  /**
+   * parses len digits starting at p. Short inputs are read left to right, one limb worth of
+   * digits per multiply-add on the accumulator. Long inputs are split in two, the upper part
+   * is multiplied by a power radix^(digits*2^i) from powers (which is filled on demand)
+   * and the lower part is added.
+   */
+  static BigInt parse_digits(const char *p, size_t len, uint8_t radix, std::vector<BigInt> &powers) {
+    if (!(radix & (radix-1))) {
+      return parse_digits_pow2(p, len, radix);
+    }
+
+    uint8_t digits;
+    const internal_type power = radix_limb_power(radix, digits);
+    BigInt result;
+
+    if (len > (size_t)digits * parse_dc_threshold) {
+      size_t l = 0;
+      while (((size_t)digits << (l+1)) <= len/2)
+        l++;
+      if (powers.empty())
+        powers.push_back(BigInt(power));
+      while (powers.size() <= l)
+        powers.push_back(powers.back() * powers.back());
+
+      const size_t low_len = (size_t)digits << l;
+      result = parse_digits(p, len - low_len, radix, powers) * powers[l];
+      result.add_abs(parse_digits(p + len - low_len, low_len, radix, powers));
+      return result;
+    }
+
+    result.m_data.reserve(len/digits + 1);
+    size_t cnt = len % digits ? len % digits : digits;
+    for (size_t pos = 0; pos < len; pos += cnt, cnt = digits) {
+      internal_type value = 0, multiplier = 1;
+      for (size_t i = 0; i < cnt; ++i) {
+        value = value * radix + digit_value(p[pos+i], radix);
+        multiplier *= radix;
+      }
+      const size_t n = result.m_data.size();
+      if (n) {
+        internal_type *data = &result.m_data[0];
+        internal_type carry = limbs_mul_1(data, data, n, multiplier);
+        carry += limbs_add_1(data, data, n, value);
+        if (carry)
+          result.m_data.push_back(carry);
+      } else if (value) {
+        result.m_data.push_back(value);
+      }
+    }
+    return result;
+  }
 
   /**
    * returns the position of the highest bit set, or zero if no bit is set.
@@ -122,96 +731,238 @@ class BigInt {
     if (!m_data.size())
       return 0;
 
-    uint64_t pos = m_data.size()-1;
-    internal_type highest = m_data[pos];
-    pos = pos * internal_bitlen + 1;
+    return uint64_t(m_data.size()) * internal_bitlen - count_leading_zeros(m_data.back());
+  }
 
-    // there is a nice way of doing binary search here:
-    // if (highest & 0xffff0000) pos += 32;
-    // if (highest & 0x00ff00ff) pos += 16; etc.
-    // but it depends on the intenal_type_size, and needs to be generalized with templates or something.
+  /**
+   * shifts the absolute value right by s bits, the bits shifted out are lost (so negative
+   * numbers are rounded towards zero). The limbs are moved down in one pass, the buffer
+   * is never reallocated.
+   */
+  BigInt& operator>>=(uint64_t s) {
+    const size_t n = m_data.size();
+    if (!n || s == 0)
+      return *this;
 
-    while (highest >>= 1)
-      pos++;
-    return pos;
+    const uint64_t limbs = s / internal_bitlen;
+    if (limbs >= n) {
+      m_data.clear();
+      neg = false;
+      return *this;
+    }
+    const uint8_t bits = s % internal_bitlen;
+    internal_type *data = &m_data[0];
+    if (bits) {
+      limbs_rshift(data, data + limbs, n - limbs, bits);
+    } else {
+      std::copy(data + limbs, data + n, data);
+    }
+    m_data.resize(n - limbs);
+    if (!m_data.back())
+      m_data.pop_back();
+    if (!m_data.size())
+      neg = false;
+    return *this;
   }
 
-  void operator>>=(uint64_t s) {
-    if (!m_data.size() || s == 0)
-      return;
+  /**
+   * shifts the absolute value left by s bits. The buffer is resized to the final length
+   * once and the limbs are moved up from the top, in place.
+   */
+  BigInt& operator <<=(uint64_t s) {
+    const size_t n = m_data.size();
+    if (!n || s == 0)
+      return *this;
 
-    // remove blocks that are shifted out completely.
-    if (s > sizeof(internal_type)*8) {
-      uint64_t delcount = s/(sizeof(internal_type)*8);
-      if (delcount >= m_data.size()) {
-        m_data.clear();
-        return;
-      }
-      m_data.erase(m_data.begin(), m_data.begin()+delcount);
-      s %= (sizeof(internal_type)*8);
+    const size_t limbs = s / internal_bitlen;
+    const uint8_t bits = s % internal_bitlen;
+    const bool carry_limb = bits && (m_data[n-1] >> (internal_bitlen - bits));
+    m_data.resize(n + limbs + carry_limb);
+    internal_type *data = &m_data[0];
+    if (bits) {
+      internal_type out = limbs_lshift(data + limbs, data, n, bits);
+      if (carry_limb)
+        data[n + limbs] = out;
+    } else {
+      std::copy_backward(data, data + n, data + n + limbs);
     }
+    std::fill(data, data + limbs, internal_type(internal_0));
+    return *this;
+  }
 
-    // m_data now has at least one element and s is <= 64
-    size_t i = 0;
-    internal_type mask = internal_max; // for s == 64, we'll copy all.
-    if (s < sizeof(internal_type)*8) {
-      mask = (1ULL << s) - 1; // create bitfield with s times 1 at the end.
-    }
-
-    for (; i < m_data.size()-1; ++i) {
-      // TODO verify that this is in fact a logical shift, not an arithmetic shift (which would keep the sign bit)
-      //      tests should cover that.
-      //      -- verified that shr and shl instructions are generated. Might not be true when a
-      //         signed internal type is used 
-      
-      // need to handle case s == num_bits seperately, since shr/shl by the wordlength has no effect (shift is effectively mod wordlength)
-      if (s == sizeof(internal_type)*8) {
-        m_data[i] = m_data[i+1];
-      } else {
-        // first, "make room" in the target block
-        m_data[i] >>= s;
-        // copy the lower s bits from the source block to the upper s bits of the target block
-        m_data[i] |= (mask & m_data[i+1]) << (sizeof(internal_type)*8 - s);
-      }
-    }
+  /**
+   * the shifted value is written straight into a buffer of the final size.
+   */
+  friend BigInt operator << (const BigInt &a, uint64_t s) {
+    BigInt result;
+    const size_t n = a.m_data.size();
+    if (!n)
+      return result;
 
-    // finally, shift the last remaining element and remove if necessary
-    m_data[i] >>= s;
-    if (m_data[i] == 0 || s == sizeof(internal_type)*8) {
-      m_data.resize(m_data.size()-1);
+    const size_t limbs = s / internal_bitlen;
+    const uint8_t bits = s % internal_bitlen;
+    const bool carry_limb = bits && (a.m_data[n-1] >> (internal_bitlen - bits));
+    // the low limbs are zeroed by resize.
+    result.m_data.resize(n + limbs + carry_limb);
+    if (bits) {
+      internal_type out = limbs_lshift(&result.m_data[limbs], &a.m_data[0], n, bits);
+      if (carry_limb)
+        result.m_data[n + limbs] = out;
+    } else {
+      std::copy(a.m_data.begin(), a.m_data.end(), &result.m_data[limbs]);
     }
+    result.neg = a.neg;
+    return result;
   }
 
+  friend BigInt operator << (BigInt &&a, uint64_t s) {
+    a <<= s;
+    return std::move(a);
+  }
 
-  void operator <<=(uint64_t s) {
-    if (!m_data.size() || s == 0)
-      return;
+  friend BigInt operator >> (const BigInt &a, uint64_t s) {
+    BigInt result;
+    const size_t n = a.m_data.size();
+    const uint64_t limbs = s / internal_bitlen;
+    if (limbs >= n)
+      return result;
 
-    // add empty elements to the front of the vector if s is larger than the internal bitlength
-    if (s >= internal_bitlen) {
-      // instantiate a new internal_type(internal_0) because insert wants a const reference
-      // TODO this is one of the main performance bottlenecks for div_abs atm
-      m_data.insert(m_data.begin(), s/internal_bitlen, internal_type(internal_0));
-      s %= internal_bitlen;
-      if (s == 0)
-        return;
+    const uint8_t bits = s % internal_bitlen;
+    result.m_data.resize(n - limbs);
+    if (bits) {
+      limbs_rshift(&result.m_data[0], &a.m_data[limbs], n - limbs, bits);
+    } else {
+      std::copy(a.m_data.begin() + limbs, a.m_data.end(), &result.m_data[0]);
     }
+    if (!result.m_data.back())
+      result.m_data.pop_back();
+    result.neg = a.neg && result.m_data.size();
+    return result;
+  }
+
+  friend BigInt operator >> (BigInt &&a, uint64_t s) {
+    a >>= s;
+    return std::move(a);
+  }
+
+  /**
+   * the bitwise operators work on the two's complement, with infinitely many sign bits above
+   * the top limb (as in GMP or Python): x & y is negative if both are, x | y if either is,
+   * x ^ y if exactly one is, and ~x = -x - 1. For non-negative numbers that's just the
+   * limbs, negative ones take a pass to turn |x| into ~(|x| - 1) and back.
+   */
+  friend BigInt operator & (const BigInt &a, const BigInt &b) {
+    return bitwise(a, b, [](internal_type x, internal_type y) { return x & y; });
+  }
+
+  friend BigInt operator | (const BigInt &a, const BigInt &b) {
+    return bitwise(a, b, [](internal_type x, internal_type y) { return x | y; });
+  }
+
+  friend BigInt operator ^ (const BigInt &a, const BigInt &b) {
+    return bitwise(a, b, [](internal_type x, internal_type y) { return x ^ y; });
+  }
+
+  BigInt& operator &= (const BigInt &other) {
+    const size_t n = std::min(m_data.size(), other.m_data.size());
+    if (neg || other.neg)
+      return *this = *this & other;
+    // the limbs above the shorter one are cleared
+    for (size_t i = 0; i < n; ++i)
+      m_data[i] &= other.m_data[i];
+    m_data.resize(n);
+    remove_empty_registers();
+    return *this;
+  }
+
+  BigInt& operator |= (const BigInt &other) {
+    const size_t no = other.m_data.size();
+    if (neg || other.neg)
+      return *this = *this | other;
+    if (m_data.size() < no)
+      m_data.resize(no);
+    for (size_t i = 0; i < no; ++i)
+      m_data[i] |= other.m_data[i];
+    return *this;
+  }
+
+  BigInt& operator ^= (const BigInt &other) {
+    const size_t no = other.m_data.size();
+    if (neg || other.neg)
+      return *this = *this ^ other;
+    if (m_data.size() < no)
+      m_data.resize(no);
+    for (size_t i = 0; i < no; ++i)
+      m_data[i] ^= other.m_data[i];
+    remove_empty_registers();
+    return *this;
+  }
 
-    // if the highest set bit plus the shift points to the next element, we need an
-    // extra element at the end:
-    if (get_highest_set_bit_position() + s > internal_bitlen) {
-      m_data.push_back(internal_type(internal_0));
+  BigInt operator ~ () const {
+    BigInt result(*this, false);
+    if (neg) {
+      result -= BigInt(1ULL);
+    } else {
+      result += BigInt(1ULL);
+      result.neg = true;
     }
+    return result;
+  }
 
+  private:
+  /**
+   * a op b limb by limb on the two's complement, see operator&. op(0, 0) must be 0.
+   */
+  template <typename F>
+  static BigInt bitwise(const BigInt &a, const BigInt &b, const F &op) {
+    const size_t na = a.m_data.size(), nb = b.m_data.size(), n = std::max(na, nb);
+    // a zero with the negative flag set is still zero
+    const bool neg_a = a.neg && na, neg_b = b.neg && nb;
+    BigInt result;
+    if (!n)
+      return result;
+    result.m_data.resize(n);
+    internal_type *r = &result.m_data[0];
+    if (!neg_a && !neg_b) {
+      for (size_t i = 0; i < n; ++i)
+        r[i] = op(i < na ? a.m_data[i] : 0, i < nb ? b.m_data[i] : 0);
+      result.remove_empty_registers();
+      return result;
+    }
 
-    for (int64_t i = m_data.size()-1; i > 0; --i) {
-      m_data[i] <<= s;
-      m_data[i] |= (m_data[i-1] >> (internal_bitlen - s));
+    ScratchFrame frame;
+    internal_type *ta = frame.alloc<internal_type>(2*n), *tb = ta + n;
+    twos_complement(ta, a, n);
+    twos_complement(tb, b, n);
+    for (size_t i = 0; i < n; ++i)
+      r[i] = op(ta[i], tb[i]);
+    // the sign bits above the limbs
+    if (op(neg_a ? internal_max : 0, neg_b ? internal_max : 0)) {
+      for (size_t i = 0; i < n; ++i)
+        r[i] = ~r[i];
+      if (limbs_add_1(r, r, n, 1))
+        result.m_data.push_back(1);
+      result.neg = true;
     }
-    m_data[0] <<= s;
+    result.remove_empty_registers();
+    return result;
+  }
 
+  /**
+   * the low n limbs of x in two's complement, x must fit into them.
+   */
+  static void twos_complement(internal_type *r, const BigInt &x, size_t n) {
+    const size_t nx = x.m_data.size();
+    std::copy(x.m_data.begin(), x.m_data.end(), r);
+    std::fill(r + nx, r + n, internal_type(0));
+    if (!x.neg || !nx)
+      return;
+    limbs_sub_1(r, r, n, 1);
+    for (size_t i = 0; i < n; ++i)
+      r[i] = ~r[i];
   }
-  
+
+  public:
   /**
    * Returns |this| < |r|
    * ("less then" on the absolute values)
@@ -293,14 +1044,25 @@ class BigInt {
   }
 
   /**
-   * Add the absolute value of other to this object's absolute value.
+   * Add the absolute value of other to this object's absolute value, in one pass over the
+   * limbs. other may be this object.
    */
   void add_abs( const BigInt &other) {
-    // iterate backwards so that this method can be used to add the object
-    // to itself.
-    for (ssize_t idx = other.m_data.size()-1; idx >= 0; --idx) {
-      add_bits_at_pos(idx*internal_bitlen, other.m_data[idx]);
+    const size_t n = m_data.size(), no = other.m_data.size();
+    if (!no)
+      return;
+    internal_type carry;
+    if (n >= no) {
+      carry = limbs_add(&m_data[0], &m_data[0], n, &other.m_data[0], no);
+    } else {
+      // make room for a carry out as well, so the buffer grows at most once.
+      if (m_data.capacity() < no)
+        m_data.reserve(no + 1);
+      m_data.resize(no);
+      carry = limbs_add(&m_data[0], &other.m_data[0], no, &m_data[0], n);
     }
+    if (carry)
+      m_data.push_back(carry);
   }
 
   /**
@@ -325,61 +1087,104 @@ class BigInt {
    * |other| must be lower than or equal to |this|.
    */
   void sub_abs( const BigInt &other) {
-    if (other.m_data.size() > m_data.size()) {
+    const size_t n = m_data.size(), no = other.m_data.size();
+    if (no > n) {
       m_data.clear();
       return;
     }
+    if (!no)
+      return;
+    limbs_sub(&m_data[0], &m_data[0], n, &other.m_data[0], no);
+    remove_empty_registers();
+  }
 
-    uint8_t carry_in = 0, carry_out = 0;
-    for (uint64_t i = 0; i < m_data.size(); ++i) {
-      carry_out = 0;
-      if (other.m_data.size() > i) {
-        if (other.m_data[i] > m_data[i]) {
-          carry_out = 1;
-        }
-        m_data[i] -= other.m_data[i];
-      }
-      if (carry_in > m_data[i]) {
-        carry_out = 1;
-      }
-      m_data[i] -= carry_in;
-      carry_in = carry_out;
-    }
+  /**
+   * replaces the absolute value of this object by |other| - |this|. |this| must be lower
+   * than |other|.
+   */
+  void rsub_abs(const BigInt &other) {
+    const size_t n = m_data.size(), no = other.m_data.size();
+    m_data.resize(no);
+    limbs_sub(&m_data[0], &other.m_data[0], no, &m_data[0], n);
     remove_empty_registers();
   }
 
-  void operator += (const BigInt &other) {
+  BigInt& operator += (const BigInt &other) {
     if (neg == other.neg) {
       add_abs(other);
+    } else if (!lt_abs(other)) {
+      // we are at least as large as other, so our negative flag stays (sub_abs will remove it if equal).
+      sub_abs(other);
     } else {
-      if (le_abs(other)) {
-        sub_abs(other);
-        // we are larger than other, so our negative flag stays (sub_abs will remove it if equal).
-      } else {
-        BigInt tmp = other;
-        tmp.sub_abs(*this);
-        m_data = tmp.m_data;
-        neg = other.neg;
-      }
+      rsub_abs(other);
+      neg = other.neg;
     }
+    return *this;
   }
 
-  void operator -= (const BigInt &other) {
-    // Make sure that the other number is smaller than this. If not,
-    // subtract the other way round and set the negative flag on the result.
-    if (lt_abs(other)) {
-      BigInt tmp(other);
-      tmp -= *this;
-      m_data = tmp.m_data;
-      neg = true;
-      return;
-    }
-    // "other"'s absolute value is now lower than ours.
-    if (neg == other.neg) {
+  BigInt& operator -= (const BigInt &other) {
+    if (neg != other.neg) {
+      // a - (-b) = a + b and -a - b = -(a + b), the sign stays.
+      add_abs(other);
+    } else if (!lt_abs(other)) {
       sub_abs(other);
     } else {
-      add_abs(other);
+      // other is larger, subtract the other way round and flip the sign.
+      rsub_abs(other);
+      neg = !neg;
     }
+    return *this;
+  }
+
+  friend BigInt operator + (const BigInt &a, const BigInt &b) {
+    BigInt sum(a);
+    sum += b;
+    return sum;
+  }
+
+  /**
+   * the overloads for temporaries accumulate into the expiring operand, which saves the
+   * copy and usually the allocation for the result.
+   */
+  friend BigInt operator + (BigInt &&a, const BigInt &b) {
+    a += b;
+    return std::move(a);
+  }
+
+  friend BigInt operator + (const BigInt &a, BigInt &&b) {
+    b += a;
+    return std::move(b);
+  }
+
+  friend BigInt operator + (BigInt &&a, BigInt &&b) {
+    a += b;
+    return std::move(a);
+  }
+
+  friend BigInt operator - (const BigInt &a, const BigInt &b) {
+    BigInt difference(a);
+    difference -= b;
+    return difference;
+  }
+
+  friend BigInt operator - (BigInt &&a, const BigInt &b) {
+    a -= b;
+    return std::move(a);
+  }
+
+  /**
+   * a - b = -(b - a)
+   */
+  friend BigInt operator - (const BigInt &a, BigInt &&b) {
+    b -= a;
+    if (!b.is_zero())
+      b.neg = !b.neg;
+    return std::move(b);
+  }
+
+  friend BigInt operator - (BigInt &&a, BigInt &&b) {
+    a -= b;
+    return std::move(a);
   }
 
   /**
@@ -412,12 +1217,98 @@ class BigInt {
     // for the remaining bits, we need to know how large the overflow was, and extract those bytes.
     uint64_t remaining_bits = (start_field_shift + n) % internal_bitlen;
     mask = ((1ULL << remaining_bits)-1);
-    // shift the resulting block to the MSB area (TODO we don't even need to mask, right?):
-    internal_type total = (m_data[end_field_idx] & mask) << (internal_bitlen - remaining_bits);
+    // shift the resulting block above the bits taken from the first block (TODO we don't even need to mask, right?):
+    internal_type total = (m_data[end_field_idx] & mask) << (n - remaining_bits);
     total |= start_data;
     return total;
   }
 
+  /**
+   * bit pos of the two's complement, as the bitwise operators see it (so for negative
+   * numbers all bits above the top limb are set).
+   */
+  bool test_bit(uint64_t pos) const {
+    const uint64_t idx = pos / internal_bitlen;
+    const bool bit = idx < m_data.size() && ((m_data[idx] >> (pos % internal_bitlen)) & 1);
+    if (!neg || is_zero())
+      return bit;
+    // -x = ~(x - 1): the bits up to the lowest set one are the same, the ones above flipped
+    const uint64_t low = count_trailing_zeros();
+    return pos <= low ? bit : !bit;
+  }
+
+  /**
+   * sets bit pos of the two's complement to value, see test_bit. Non-negative numbers get
+   * it set in place, negative ones go through operator| and operator&.
+   */
+  void set_bit(uint64_t pos, bool value = true) {
+    if (neg) {
+      const BigInt bit = BigInt(1ULL) << pos;
+      *this = value ? *this | bit : *this & ~bit;
+      return;
+    }
+    const size_t idx = pos / internal_bitlen;
+    const internal_type mask = internal_type(1) << (pos % internal_bitlen);
+    if (value) {
+      if (idx >= m_data.size())
+        m_data.resize(idx + 1);
+      m_data[idx] |= mask;
+    } else if (idx < m_data.size()) {
+      m_data[idx] &= ~mask;
+      remove_empty_registers();
+    }
+  }
+
+  /**
+   * the number of set bits of |this|.
+   */
+  uint64_t popcount() const {
+    uint64_t count = 0;
+    for (size_t i = 0; i < m_data.size(); ++i)
+      count += popcount(m_data[i]);
+    return count;
+  }
+
+  /**
+   * the number of zero bits below the lowest set bit of |this| (the same for the two's
+   * complement), 0 for zero.
+   */
+  uint64_t count_trailing_zeros() const {
+    for (size_t i = 0; i < m_data.size(); ++i) {
+      if (m_data[i])
+        return uint64_t(i) * internal_bitlen + count_trailing_zeros(m_data[i]);
+    }
+    return 0;
+  }
+
+  /**
+   * whether |this| is a power of two (one bit set).
+   */
+  bool is_pow2_abs() const {
+    const size_t n = m_data.size();
+    if (!n || (m_data[n-1] & (m_data[n-1] - 1)))
+      return false;
+    for (size_t i = 0; i + 1 < n; ++i) {
+      if (m_data[i])
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * keeps the low bits of |this|, so it's |this| % 2^bits with the sign of this (unless
+   * that's zero).
+   */
+  void truncate_bits(uint64_t bits) {
+    const uint64_t limbs = (bits + internal_bitlen - 1) / internal_bitlen;
+    if (limbs > m_data.size())
+      return;
+    m_data.resize(limbs);
+    if (bits % internal_bitlen)
+      m_data[limbs-1] &= (internal_type(1) << (bits % internal_bitlen)) - 1;
+    remove_empty_registers();
+  }
+
   /**
    * add the data from value at the position 'position'.
    * position is zero-indexed.
@@ -464,169 +1355,4020 @@ class BigInt {
     } while (current);
   }
 
-  BigInt operator * (const BigInt &other) const {
-    // multiplication of two binary digits will require at most 2*bit_len bits in the result.
-    // maybe there is a assembly function where one can explicitly reference the overflowing
-    // bits, but for now, take only half the input field, multiply it and add the resulting 2*bit_len
-    // to the sum of the source positions.
+  /**
+   * multiplies two limbs. The lower half of the double-width product is returned,
+   * the upper half is written to hi.
+   */
+  static BIGINT_CONSTEXPR14 internal_type mul_limb(const internal_type a, const internal_type b, internal_type &hi) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 p = (unsigned __int128)a * b;
+    hi = (internal_type)(p >> internal_bitlen);
+    return (internal_type)p;
+#else
+    // no double-width type available, multiply the half limbs and put the pieces together.
+    const uint8_t half = internal_bitlen/2;
+    const internal_type lo_mask = internal_max >> half;
+    internal_type a_lo = a & lo_mask, a_hi = a >> half;
+    internal_type b_lo = b & lo_mask, b_hi = b >> half;
 
-    BigInt target(0);
-    // this code should even support 7-bit architectures ;)
-    const uint8_t blocksz = internal_bitlen/2;
+    internal_type ll = a_lo * b_lo;
+    internal_type lh = a_lo * b_hi;
+    internal_type hl = a_hi * b_lo;
+    internal_type hh = a_hi * b_hi;
 
-    // iterate over all blocks of blocksz in other
-    const uint64_t other_msb = other.get_highest_set_bit_position();
-    const uint64_t this_msb = get_highest_set_bit_position();
+    // the middle column can not overflow: (2^h-1) + 2*(2^h-1)^2 < 2^2h
+    internal_type mid = (ll >> half) + (lh & lo_mask) + (hl & lo_mask);
+    hi = hh + (lh >> half) + (hl >> half) + (mid >> half);
+    return (mid << half) | (ll & lo_mask);
+#endif
+  }
 
-    // TODO is it better to iterate the other way round? Also, verify that there is not an off-by-one error here (b/c get_highest_set_bit_pos is 1-indexed)
-    for (uint64_t other_position = 0; other_position <= other_msb; other_position += blocksz) {
-      const internal_type other_block = other.get_bits_at_pos(other_position, blocksz);
-      // iterate over all blocks of blocksz in the internal buffer. We need to refresh the position
-      // each iteration since it will likely grow.
-      for (uint64_t this_position = 0; this_position <= this_msb; this_position += blocksz) {
-        const internal_type this_block = get_bits_at_pos(this_position, blocksz);
-        target.add_bits_at_pos(other_position + this_position, this_block * other_block);
-      }
+  /**
+   * the kernels for the limb loops, each level includes the ones before it. x86_64 runs the
+   * additions and subtractions as adc/sbb chains, bmi2_adx adds the multiplication rows with
+   * mulx and two independent carry chains (adcx/adox) and shlx/shrx in the shifts. The
+   * level is picked from the CPU at runtime, so one binary runs everywhere.
+   */
+  enum kernel_level { kernels_generic, kernels_x86_64, kernels_bmi2_adx };
+
+  /**
+   * the best kernels the CPU supports.
+   */
+  static kernel_level detect_kernels() {
+#ifdef BIGINT_X86
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, 0) >= 7) {
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
+      if ((ebx & bit_BMI2) && (ebx & bit_ADX))
+        return kernels_bmi2_adx;
     }
+    return kernels_x86_64;
+#else
+    return kernels_generic;
+#endif
+  }
 
-    return target;
+  static kernel_level kernels() {
+    return kernel_setting();
+  }
+
+  /**
+   * limits the limb loops to the given kernels, for testing and benchmarks. Levels the CPU
+   * doesn't support are ignored. Must not be called while other threads do arithmetic.
+   */
+  static void set_kernels(kernel_level level) {
+    kernel_setting() = std::min(level, detect_kernels());
+  }
+
+  private:
+  static kernel_level& kernel_setting() {
+    static kernel_level level = detect_kernels();
+    return level;
+  }
+
+#ifdef BIGINT_X86
+  /*
+   * The assembly loops take the n % 4 single limbs first and then blocks of four. Only
+   * lea, mov, jrcxz and jmp run between the arithmetic, none of them touch the flags, so
+   * the carries stay in CF (and OF) through the whole loop.
+   */
+
+  static internal_type limbs_add_n_x86(internal_type *r, const internal_type *a, const internal_type *b,
+                                       size_t n) {
+    size_t blocks = n / 4, rest = n % 4;
+    internal_type carry;
+    __asm__ __volatile__(
+      "xorl %k[carry], %k[carry]\n\t"
+      "1: jrcxz 2f\n\t"
+      "movq (%[a]), %%r8\n\t"
+      "adcq (%[b]), %%r8\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "leaq 8(%[a]), %[a]\n\t"
+      "leaq 8(%[b]), %[b]\n\t"
+      "leaq 8(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 1b\n"
+      "2: movq %[blocks], %%rcx\n"
+      "3: jrcxz 4f\n\t"
+      "movq (%[a]), %%r8\n\t"
+      "movq 8(%[a]), %%r9\n\t"
+      "adcq (%[b]), %%r8\n\t"
+      "adcq 8(%[b]), %%r9\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "movq %%r9, 8(%[r])\n\t"
+      "movq 16(%[a]), %%r8\n\t"
+      "movq 24(%[a]), %%r9\n\t"
+      "adcq 16(%[b]), %%r8\n\t"
+      "adcq 24(%[b]), %%r9\n\t"
+      "movq %%r8, 16(%[r])\n\t"
+      "movq %%r9, 24(%[r])\n\t"
+      "leaq 32(%[a]), %[a]\n\t"
+      "leaq 32(%[b]), %[b]\n\t"
+      "leaq 32(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 3b\n"
+      "4: setc %b[carry]"
+      : [carry] "=&a" (carry), [r] "+r" (r), [a] "+r" (a), [b] "+r" (b), "+c" (rest)
+      : [blocks] "r" (blocks)
+      : "r8", "r9", "cc", "memory");
+    return carry;
   }
 
-  void operator *= (const BigInt &other) {
-    BigInt tmp(*this * other);
-    m_data = tmp.m_data;
-    neg = tmp.neg;
+  static internal_type limbs_sub_n_x86(internal_type *r, const internal_type *a, const internal_type *b,
+                                       size_t n) {
+    size_t blocks = n / 4, rest = n % 4;
+    internal_type borrow;
+    __asm__ __volatile__(
+      "xorl %k[borrow], %k[borrow]\n\t"
+      "1: jrcxz 2f\n\t"
+      "movq (%[a]), %%r8\n\t"
+      "sbbq (%[b]), %%r8\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "leaq 8(%[a]), %[a]\n\t"
+      "leaq 8(%[b]), %[b]\n\t"
+      "leaq 8(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 1b\n"
+      "2: movq %[blocks], %%rcx\n"
+      "3: jrcxz 4f\n\t"
+      "movq (%[a]), %%r8\n\t"
+      "movq 8(%[a]), %%r9\n\t"
+      "sbbq (%[b]), %%r8\n\t"
+      "sbbq 8(%[b]), %%r9\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "movq %%r9, 8(%[r])\n\t"
+      "movq 16(%[a]), %%r8\n\t"
+      "movq 24(%[a]), %%r9\n\t"
+      "sbbq 16(%[b]), %%r8\n\t"
+      "sbbq 24(%[b]), %%r9\n\t"
+      "movq %%r8, 16(%[r])\n\t"
+      "movq %%r9, 24(%[r])\n\t"
+      "leaq 32(%[a]), %[a]\n\t"
+      "leaq 32(%[b]), %[b]\n\t"
+      "leaq 32(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 3b\n"
+      "4: setc %b[borrow]"
+      : [borrow] "=&a" (borrow), [r] "+r" (r), [a] "+r" (a), [b] "+r" (b), "+c" (rest)
+      : [blocks] "r" (blocks)
+      : "r8", "r9", "cc", "memory");
+    return borrow;
+  }
+
+  /*
+   * mulx leaves the flags alone, so the low halves of the products can go into one carry
+   * chain (CF, adcx) while a second one (OF, adox) adds them to r.
+   */
+
+  static internal_type limbs_mul_1_adx(internal_type *r, const internal_type *a, size_t n, internal_type b) {
+    size_t blocks = n / 4, rest = n % 4;
+    internal_type carry;
+    __asm__ __volatile__(
+      "xorl %k[carry], %k[carry]\n\t"
+      "1: jrcxz 2f\n\t"
+      "mulxq (%[a]), %%r8, %%r9\n\t"
+      "adcxq %[carry], %%r8\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "movq %%r9, %[carry]\n\t"
+      "leaq 8(%[a]), %[a]\n\t"
+      "leaq 8(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 1b\n"
+      "2: movq %[blocks], %%rcx\n"
+      "3: jrcxz 4f\n\t"
+      "mulxq (%[a]), %%r8, %%r9\n\t"
+      "adcxq %[carry], %%r8\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "mulxq 8(%[a]), %%r8, %[carry]\n\t"
+      "adcxq %%r9, %%r8\n\t"
+      "movq %%r8, 8(%[r])\n\t"
+      "mulxq 16(%[a]), %%r8, %%r9\n\t"
+      "adcxq %[carry], %%r8\n\t"
+      "movq %%r8, 16(%[r])\n\t"
+      "mulxq 24(%[a]), %%r8, %[carry]\n\t"
+      "adcxq %%r9, %%r8\n\t"
+      "movq %%r8, 24(%[r])\n\t"
+      "leaq 32(%[a]), %[a]\n\t"
+      "leaq 32(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 3b\n"
+      "4: movl $0, %%r8d\n\t"
+      "adcxq %%r8, %[carry]"
+      : [carry] "=&a" (carry), [r] "+r" (r), [a] "+r" (a), "+c" (rest)
+      : [blocks] "r" (blocks), "d" (b)
+      : "r8", "r9", "cc", "memory");
+    return carry;
+  }
+
+  static internal_type limbs_addmul_1_adx(internal_type *r, const internal_type *a, size_t n, internal_type b) {
+    size_t blocks = n / 4, rest = n % 4;
+    internal_type carry;
+    __asm__ __volatile__(
+      "xorl %k[carry], %k[carry]\n\t"
+      "1: jrcxz 2f\n\t"
+      "mulxq (%[a]), %%r8, %%r9\n\t"
+      "adcxq %[carry], %%r8\n\t"
+      "adoxq (%[r]), %%r8\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "movq %%r9, %[carry]\n\t"
+      "leaq 8(%[a]), %[a]\n\t"
+      "leaq 8(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 1b\n"
+      "2: movq %[blocks], %%rcx\n"
+      "3: jrcxz 4f\n\t"
+      "mulxq (%[a]), %%r8, %%r9\n\t"
+      "adcxq %[carry], %%r8\n\t"
+      "adoxq (%[r]), %%r8\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "mulxq 8(%[a]), %%r8, %[carry]\n\t"
+      "adcxq %%r9, %%r8\n\t"
+      "adoxq 8(%[r]), %%r8\n\t"
+      "movq %%r8, 8(%[r])\n\t"
+      "mulxq 16(%[a]), %%r8, %%r9\n\t"
+      "adcxq %[carry], %%r8\n\t"
+      "adoxq 16(%[r]), %%r8\n\t"
+      "movq %%r8, 16(%[r])\n\t"
+      "mulxq 24(%[a]), %%r8, %[carry]\n\t"
+      "adcxq %%r9, %%r8\n\t"
+      "adoxq 24(%[r]), %%r8\n\t"
+      "movq %%r8, 24(%[r])\n\t"
+      "leaq 32(%[a]), %[a]\n\t"
+      "leaq 32(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 3b\n"
+      "4: movl $0, %%r8d\n\t"
+      "adcxq %%r8, %[carry]\n\t"
+      "adoxq %%r8, %[carry]"
+      : [carry] "=&a" (carry), [r] "+r" (r), [a] "+r" (a), "+c" (rest)
+      : [blocks] "r" (blocks), "d" (b)
+      : "r8", "r9", "cc", "memory");
+    return carry;
   }
 
   /**
-   * divide the current object by the denominator parameter and
-   * return the result.
-   *
-   * TODO: This code depends quite a lot on shifts, which are quite
-   *       slow unfortunately (mainly the memory allocator calls).
+   * r - (lo + carry) is computed as r + ~(lo + carry) + 1: the sum of the products runs in
+   * OF, the subtraction in CF, which starts at one and ends up as the inverted borrow.
    */
-  BigInt div_abs(const BigInt &denominator, BigInt &modulo) const {
-    if (denominator.lt_abs(2)) {
-      return BigInt(*this);
+  static internal_type limbs_submul_1_adx(internal_type *r, const internal_type *a, size_t n, internal_type b) {
+    size_t blocks = n / 4, rest = n % 4;
+    internal_type borrow;
+    __asm__ __volatile__(
+      "xorl %k[borrow], %k[borrow]\n\t"
+      "stc\n"
+      "1: jrcxz 2f\n\t"
+      "mulxq (%[a]), %%r8, %%r9\n\t"
+      "adoxq %[borrow], %%r8\n\t"
+      "notq %%r8\n\t"
+      "adcxq (%[r]), %%r8\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "movq %%r9, %[borrow]\n\t"
+      "leaq 8(%[a]), %[a]\n\t"
+      "leaq 8(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 1b\n"
+      "2: movq %[blocks], %%rcx\n"
+      "3: jrcxz 4f\n\t"
+      "mulxq (%[a]), %%r8, %%r9\n\t"
+      "adoxq %[borrow], %%r8\n\t"
+      "notq %%r8\n\t"
+      "adcxq (%[r]), %%r8\n\t"
+      "movq %%r8, (%[r])\n\t"
+      "mulxq 8(%[a]), %%r8, %[borrow]\n\t"
+      "adoxq %%r9, %%r8\n\t"
+      "notq %%r8\n\t"
+      "adcxq 8(%[r]), %%r8\n\t"
+      "movq %%r8, 8(%[r])\n\t"
+      "mulxq 16(%[a]), %%r8, %%r9\n\t"
+      "adoxq %[borrow], %%r8\n\t"
+      "notq %%r8\n\t"
+      "adcxq 16(%[r]), %%r8\n\t"
+      "movq %%r8, 16(%[r])\n\t"
+      "mulxq 24(%[a]), %%r8, %[borrow]\n\t"
+      "adoxq %%r9, %%r8\n\t"
+      "notq %%r8\n\t"
+      "adcxq 24(%[r]), %%r8\n\t"
+      "movq %%r8, 24(%[r])\n\t"
+      "leaq 32(%[a]), %[a]\n\t"
+      "leaq 32(%[r]), %[r]\n\t"
+      "leaq -1(%%rcx), %%rcx\n\t"
+      "jmp 3b\n"
+      "4: movl $0, %%r8d\n\t"
+      "adoxq %%r8, %[borrow]\n\t"
+      "cmc\n\t"
+      "adcq %%r8, %[borrow]"
+      : [borrow] "=&a" (borrow), [r] "+r" (r), [a] "+r" (a), "+c" (rest)
+      : [blocks] "r" (blocks), "d" (b)
+      : "r8", "r9", "cc", "memory");
+    return borrow;
+  }
+
+  // the generic shift loops, compiled for shlx/shrx.
+  BIGINT_TARGET("bmi2")
+  static internal_type limbs_lshift_bmi2(internal_type *r, const internal_type *a, size_t n, uint8_t cnt) {
+    return limbs_lshift_generic(r, a, n, cnt);
+  }
+
+  BIGINT_TARGET("bmi2")
+  static internal_type limbs_rshift_bmi2(internal_type *r, const internal_type *a, size_t n, uint8_t cnt) {
+    return limbs_rshift_generic(r, a, n, cnt);
+  }
+#endif
+
+  static internal_type limbs_mul_1_generic(internal_type *r, const internal_type *a, size_t n, const internal_type b) {
+    internal_type carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+      internal_type hi;
+      internal_type lo = mul_limb(a[i], b, hi);
+      lo += carry;
+      carry = hi + (lo < carry);
+      r[i] = lo;
     }
+    return carry;
+  }
 
-    // Result
-    BigInt quotient(0);
-    // work variable from which fitting denominator_cp values will be subtracted in each
-    // iteration (-> modulo)
-    BigInt numerator(*this);
-
-    uint64_t denominator_msb = denominator.get_highest_set_bit_position();
-
-
-    while (denominator.le_abs(numerator)) {
-      uint64_t numerator_msb = numerator.get_highest_set_bit_position();
-      uint64_t shiftfactor = numerator_msb - denominator_msb;
-
-      // work variable which can be shifted around. First, it is MSB-aligned with the numerator,
-      // then it is checked whether it "fits". If not (that is, the less significant bits make the
-      // numerator "higher" than the (shifted) denominator), shift one to the right and subtract -
-      // this will always fit.
-      BigInt denominator_cp(denominator);
-      denominator_cp <<= shiftfactor;
-      if (denominator_cp.le_abs(numerator)) {
-        numerator.sub_abs(denominator_cp);
-        quotient.add_bits_at_pos(shiftfactor, 1);
-      } else {
-        denominator_cp >>= 1;
-        numerator.sub_abs(denominator_cp);
-        quotient.add_bits_at_pos(shiftfactor-1, 1);
-      }
+  static internal_type limbs_addmul_1_generic(internal_type *r, const internal_type *a, size_t n, const internal_type b) {
+    internal_type carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+      internal_type hi;
+      internal_type lo = mul_limb(a[i], b, hi);
+      lo += carry;
+      hi += (lo < carry);
+      lo += r[i];
+      carry = hi + (lo < r[i]);
+      r[i] = lo;
     }
-    modulo = numerator;
-    return quotient;
+    return carry;
   }
 
-  BigInt div_abs(const BigInt& denominator) const {
-    BigInt unused_modulo_result(0);
-    return div_abs(denominator, unused_modulo_result);
+  static internal_type limbs_submul_1_generic(internal_type *r, const internal_type *a, size_t n, const internal_type b) {
+    internal_type carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+      internal_type hi;
+      internal_type lo = mul_limb(a[i], b, hi);
+      lo += carry;
+      hi += (lo < carry);
+      carry = hi + (r[i] < lo);
+      r[i] -= lo;
+    }
+    return carry;
   }
 
+  public:
   /**
-   * Division, obviously. Dividing by zero is equivalent to dividing by 1
+   * r[0..n) = a[0..n) * b, returns the carry limb.
+   * r and a may point to the same buffer.
    */
-  BigInt operator / (const BigInt &denominator) const {
-    return BigInt(div_abs(denominator), neg ^ denominator.neg);
+  static internal_type limbs_mul_1(internal_type *r, const internal_type *a, size_t n, const internal_type b) {
+#ifdef BIGINT_X86
+    if (kernels() >= kernels_bmi2_adx)
+      return limbs_mul_1_adx(r, a, n, b);
+#endif
+    return limbs_mul_1_generic(r, a, n, b);
   }
 
   /**
-   * Modulo operation. The sign is taken from the dividend (same as the C++ ISO-2011 standard)
+   * r[0..n) += a[0..n) * b, returns the carry limb.
    */
-  BigInt operator % (const BigInt &denominator) const {
-    BigInt modulo_result(0);
-    div_abs(denominator, modulo_result);
-    modulo_result.neg = neg;
-    return modulo_result;
+  static internal_type limbs_addmul_1(internal_type *r, const internal_type *a, size_t n, const internal_type b) {
+#ifdef BIGINT_X86
+    if (kernels() >= kernels_bmi2_adx)
+      return limbs_addmul_1_adx(r, a, n, b);
+#endif
+    return limbs_addmul_1_generic(r, a, n, b);
   }
 
   /**
-   * returns the string representation.
-   * @param radix base to use
-   * @param uppercase whether to use uppercase letters (for radix > 10)
+   * r[0..n) -= a[0..n) * b, returns the borrow limb.
    */
-  std::string toString(uint8_t radix=10, bool uppercase=false) const {
-    std::string ret;
-    BigInt copy(*this);
+  static internal_type limbs_submul_1(internal_type *r, const internal_type *a, size_t n, const internal_type b) {
+#ifdef BIGINT_X86
+    if (kernels() >= kernels_bmi2_adx)
+      return limbs_submul_1_adx(r, a, n, b);
+#endif
+    return limbs_submul_1_generic(r, a, n, b);
+  }
+
+  /**
+   * sum = a + b + carry_in, returns the carry out. carry_in must be 0 or 1.
+   * Uses the add-with-carry instructions where the compiler exposes them, so the carry
+   * stays in the flags register across a loop.
+   */
+  static internal_type add_carry(internal_type a, internal_type b, internal_type carry_in, internal_type &sum) {
+#if defined(BIGINT_HAS_ADDCLL)
+    unsigned long long carry_out;
+    sum = __builtin_addcll(a, b, carry_in, &carry_out);
+    return carry_out;
+#elif defined(__x86_64__) || defined(_M_X64)
+    unsigned long long s;
+    unsigned char carry_out = _addcarry_u64((unsigned char)carry_in, a, b, &s);
+    sum = s;
+    return carry_out;
+#else
+    internal_type t = a + carry_in;
+    internal_type carry_out = t < carry_in;
+    sum = t + b;
+    return carry_out + (sum < b);
+#endif
+  }
 
-    bool result_neg = copy.is_neg();
+  /**
+   * diff = a - b - borrow_in, returns the borrow out. borrow_in must be 0 or 1.
+   */
+  static internal_type sub_borrow(internal_type a, internal_type b, internal_type borrow_in, internal_type &diff) {
+#if defined(BIGINT_HAS_ADDCLL)
+    unsigned long long borrow_out;
+    diff = __builtin_subcll(a, b, borrow_in, &borrow_out);
+    return borrow_out;
+#elif defined(__x86_64__) || defined(_M_X64)
+    unsigned long long d;
+    unsigned char borrow_out = _subborrow_u64((unsigned char)borrow_in, a, b, &d);
+    diff = d;
+    return borrow_out;
+#else
+    internal_type t = b + borrow_in;
+    internal_type borrow_out = t < borrow_in;
+    diff = a - t;
+    return borrow_out + (a < t);
+#endif
+  }
 
-    while (!copy.is_zero()) {
-      BigInt mod;
-      copy = copy.div_abs(radix, mod);
-      // figure out which character to use.
-      if (mod.m_data.size() == 1) {
-        // figure out which character to append.
-        if (mod.m_data[0] < 10) {
-          ret.push_back('0'+mod.m_data[0]);
-        } else {
-          if (uppercase) {
-            ret.push_back('A' + mod.m_data[0]-10);
-          } else {
-            ret.push_back('a' + mod.m_data[0]-10);
-          }
-        }
-      } else {
-        ret.push_back('0');
+  /**
+   * r[0..n) = a[0..n) + b[0..n), returns the carry. r may alias a or b.
+   */
+  static internal_type limbs_add_n(internal_type *r, const internal_type *a, const internal_type *b, size_t n) {
+#ifdef BIGINT_X86
+    if (kernels() >= kernels_x86_64)
+      return limbs_add_n_x86(r, a, b, n);
+#endif
+    internal_type carry = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      carry = add_carry(a[i], b[i], carry, r[i]);
+      carry = add_carry(a[i+1], b[i+1], carry, r[i+1]);
+      carry = add_carry(a[i+2], b[i+2], carry, r[i+2]);
+      carry = add_carry(a[i+3], b[i+3], carry, r[i+3]);
+    }
+    for (; i < n; ++i)
+      carry = add_carry(a[i], b[i], carry, r[i]);
+    return carry;
+  }
+
+  /**
+   * r[0..n) = a[0..n) - b[0..n), returns the borrow. r may alias a or b.
+   */
+  static internal_type limbs_sub_n(internal_type *r, const internal_type *a, const internal_type *b, size_t n) {
+#ifdef BIGINT_X86
+    if (kernels() >= kernels_x86_64)
+      return limbs_sub_n_x86(r, a, b, n);
+#endif
+    internal_type borrow = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      borrow = sub_borrow(a[i], b[i], borrow, r[i]);
+      borrow = sub_borrow(a[i+1], b[i+1], borrow, r[i+1]);
+      borrow = sub_borrow(a[i+2], b[i+2], borrow, r[i+2]);
+      borrow = sub_borrow(a[i+3], b[i+3], borrow, r[i+3]);
+    }
+    for (; i < n; ++i)
+      borrow = sub_borrow(a[i], b[i], borrow, r[i]);
+    return borrow;
+  }
+
+  /**
+   * r[0..n) = a[0..n) + c, returns the carry. r may alias a.
+   */
+  static internal_type limbs_add_1(internal_type *r, const internal_type *a, size_t n, internal_type c) {
+    size_t i = 0;
+    for (; i < n && c; ++i) {
+      r[i] = a[i] + c;
+      c = (r[i] < c);
+    }
+    // the rest is a plain copy, or nothing at all in place.
+    if (r != a)
+      std::copy(a + i, a + n, r + i);
+    return c;
+  }
+
+  /**
+   * r[0..n) = a[0..n) - c, returns the borrow. r may alias a.
+   */
+  static internal_type limbs_sub_1(internal_type *r, const internal_type *a, size_t n, internal_type c) {
+    size_t i = 0;
+    for (; i < n && c; ++i) {
+      internal_type ai = a[i];
+      r[i] = ai - c;
+      c = (ai < c);
+    }
+    if (r != a)
+      std::copy(a + i, a + n, r + i);
+    return c;
+  }
+
+  /**
+   * r[0..na) = a[0..na) + b[0..nb) for na >= nb, returns the carry.
+   */
+  static internal_type limbs_add(internal_type *r, const internal_type *a, size_t na,
+                                 const internal_type *b, size_t nb) {
+    internal_type carry = limbs_add_n(r, a, b, nb);
+    return limbs_add_1(r+nb, a+nb, na-nb, carry);
+  }
+
+  /**
+   * r[0..na) = a[0..na) - b[0..nb) for na >= nb, returns the borrow.
+   */
+  static internal_type limbs_sub(internal_type *r, const internal_type *a, size_t na,
+                                 const internal_type *b, size_t nb) {
+    internal_type borrow = limbs_sub_n(r, a, b, nb);
+    return limbs_sub_1(r+nb, a+nb, na-nb, borrow);
+  }
+
+  /**
+   * compares a[0..n) and b[0..n), returns -1, 0 or 1.
+   */
+  static int limbs_cmp(const internal_type *a, const internal_type *b, size_t n) {
+    for (size_t i = n; i > 0; --i) {
+      if (a[i-1] != b[i-1])
+        return a[i-1] < b[i-1] ? -1 : 1;
+    }
+    return 0;
+  }
+
+  /**
+   * r[0..na) = |a[0..na) - b[0..nb)| for na >= nb. Leading zero limbs are allowed in both
+   * operands. Returns true if b was larger than a.
+   */
+  static bool limbs_abs_sub(internal_type *r, const internal_type *a, size_t na,
+                            const internal_type *b, size_t nb) {
+    size_t i = na;
+    while (i > nb && a[i-1] == 0)
+      --i;
+    if (i == nb) {
+      while (i > 0 && a[i-1] == b[i-1])
+        --i;
+      if (i > 0 && a[i-1] < b[i-1]) {
+        limbs_sub_n(r, b, a, nb);
+        for (size_t j = nb; j < na; ++j)
+          r[j] = 0;
+        return true;
       }
     }
+    limbs_sub(r, a, na, b, nb);
+    return false;
+  }
 
-    if (result_neg) {
-      ret.push_back('-');
+  /**
+   * r[0..n) = a[0..n) << cnt, returns the bits shifted out at the top.
+   * 0 < cnt < internal_bitlen, r may alias a (the loop runs from the top).
+   */
+  static internal_type limbs_lshift(internal_type *r, const internal_type *a, size_t n, uint8_t cnt) {
+#ifdef BIGINT_X86
+    if (kernels() >= kernels_bmi2_adx)
+      return limbs_lshift_bmi2(r, a, n, cnt);
+#endif
+    return limbs_lshift_generic(r, a, n, cnt);
+  }
+
+  /**
+   * r[0..n) = a[0..n) >> cnt, returns the bits shifted out at the bottom (in the high bits
+   * of the returned limb). 0 < cnt < internal_bitlen, r may alias a.
+   */
+  static internal_type limbs_rshift(internal_type *r, const internal_type *a, size_t n, uint8_t cnt) {
+#ifdef BIGINT_X86
+    if (kernels() >= kernels_bmi2_adx)
+      return limbs_rshift_bmi2(r, a, n, cnt);
+#endif
+    return limbs_rshift_generic(r, a, n, cnt);
+  }
+
+  private:
+  static internal_type limbs_lshift_generic(internal_type *r, const internal_type *a, size_t n, uint8_t cnt) {
+    internal_type out = a[n-1] >> (internal_bitlen - cnt);
+    for (size_t i = n-1; i > 0; --i) {
+      r[i] = (a[i] << cnt) | (a[i-1] >> (internal_bitlen - cnt));
     }
-    std::string reversed(ret.rbegin(), ret.rend());
-    return reversed;
+    r[0] = a[0] << cnt;
+    return out;
   }
 
-  void dump_registers(std::string prefix = "", int fill = 4) const {
-    std::cout << prefix << " " << m_data.size() << " " << (neg?" (-)":" (+)");
+  static internal_type limbs_rshift_generic(internal_type *r, const internal_type *a, size_t n, uint8_t cnt) {
+    internal_type out = a[0] << (internal_bitlen - cnt);
+    for (size_t i = 0; i + 1 < n; ++i) {
+      r[i] = (a[i] >> cnt) | (a[i+1] << (internal_bitlen - cnt));
+    }
+    r[n-1] = a[n-1] >> cnt;
+    return out;
+  }
 
-    for (;fill > (ssize_t)m_data.size(); --fill) {
-      std::cout << "  0x" << std::setw(sizeof(internal_type)*2) << std::setfill('0') << std::hex << 0x0ULL << std::dec;
+  public:
+  /**
+   * r[0..n) = a[0..n) / 3, the division must be exact. Works by multiplying with the
+   * inverse of 3 modulo 2^internal_bitlen and feeding the high part of q*3 back as borrow.
+   */
+  static void limbs_divexact_by3(internal_type *r, const internal_type *a, size_t n) {
+    const internal_type inverse = internal_max / 3 * 2 + 1; // 0xaa...ab
+    internal_type borrow = 0;
+    for (size_t i = 0; i < n; ++i) {
+      internal_type ai = a[i];
+      internal_type x = ai - borrow;
+      borrow = (ai < borrow);
+      internal_type q = x * inverse;
+      r[i] = q;
+      internal_type hi;
+      mul_limb(q, 3, hi);
+      borrow += hi;
     }
-    for (ssize_t i = m_data.size()-1; i >= 0; --i) {
-      std::cout <<  "  0x" << std::setw(sizeof(internal_type)*2) << std::setfill('0') << std::hex << m_data[i] << std::dec;
+  }
+
+  /**
+   * adds c[0..nc) to r[0..nr), starting at limb offset off and propagating the carry up to
+   * the end of r. Leading zero limbs of c that don't fit into r are ignored, the sum
+   * itself must fit.
+   */
+  static void limbs_add_at(internal_type *r, size_t nr, size_t off, const internal_type *c, size_t nc) {
+    while (nc && c[nc-1] == 0)
+      --nc;
+    assert(off + nc <= nr);
+    internal_type carry = limbs_add(r+off, r+off, nr-off, c, nc);
+    assert(carry == 0);
+    (void)carry;
+  }
+
+  /**
+   * schoolbook multiplication, r[0..na+nb) = a[0..na) * b[0..nb).
+   * na and nb must be at least 1, r must not overlap with a or b.
+   *
+   * the first row initializes r, so the result buffer does not need to be cleared.
+   */
+  static void limbs_mul_basecase(internal_type *r, const internal_type *a, size_t na,
+                                 const internal_type *b, size_t nb) {
+    r[na] = limbs_mul_1(r, a, na, b[0]);
+    for (size_t j = 1; j < nb; ++j) {
+      r[na+j] = limbs_addmul_1(r+j, a, na, b[j]);
     }
-    std::cout << std::endl;
   }
 
   /**
-   * returns the internal representation of the data, without the neg flag.
+   * schoolbook squaring, r[0..2n) = a[0..n)^2. r must not overlap with a.
+   *
+   * Every cross product a[i]*a[j] with i < j appears twice in the square, so each of them
+   * is computed once, the sum is doubled with a shift and the squares a[i]^2 are added on
+   * the diagonal.
    */
-  data_collection_type get_internal_representation() {
-    return m_data;
+  static void limbs_sqr_basecase(internal_type *r, const internal_type *a, size_t n) {
+    if (n == 1) {
+      r[0] = mul_limb(a[0], a[0], r[1]);
+      return;
+    }
+    r[0] = 0;
+    r[n] = limbs_mul_1(r+1, a+1, n-1, a[0]);
+    for (size_t i = 1; i + 1 < n; ++i) {
+      r[n+i] = limbs_addmul_1(r+2*i+1, a+i+1, n-i-1, a[i]);
+    }
+    r[2*n-1] = limbs_lshift(r+1, r+1, 2*n-2, 1);
+
+    internal_type carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+      internal_type hi;
+      internal_type lo = mul_limb(a[i], a[i], hi);
+      carry = add_carry(r[2*i], lo, carry, r[2*i]);
+      carry = add_carry(r[2*i+1], hi, carry, r[2*i+1]);
+    }
+    assert(carry == 0);
   }
 
-  bool is_neg() {
-    return neg;
+  /**
+   * Karatsuba multiplication, r[0..na+nb) = a[0..na) * b[0..nb).
+   * Requires na >= nb > (na+1)/2. If a and b are the same operand, the product is a square
+   * and only one of the differences has to be computed.
+   *
+   * a and b are split at h limbs into a1*B^h + a0 and b1*B^h + b0, the middle term is
+   * a0*b1 + a1*b0 = a0*b0 + a1*b1 - (a0-a1)*(b0-b1). The differences are calculated as
+   * absolute values, which avoids the extra carry limb the additive variant would need.
+   */
+  static void limbs_mul_karatsuba(internal_type *r, const internal_type *a, size_t na,
+                                  const internal_type *b, size_t nb) {
+    const size_t h = (na+1)/2;
+    const size_t n = na + nb;
+    assert(na >= nb && nb > h);
+
+    ScratchFrame frame;
+    internal_type *da = frame.alloc<internal_type>(6*h + 1);
+    internal_type *db = da + h;
+    internal_type *zm = db + h;
+    internal_type *t = zm + 2*h;
+
+    const bool square = a == b && na == nb;
+    bool neg_a = limbs_abs_sub(da, a, h, a+h, na-h);
+    bool neg_b = neg_a;
+    if (square) {
+      db = da;
+    } else {
+      neg_b = limbs_abs_sub(db, b, h, b+h, nb-h);
+    }
+
+    // the recursive calls see identical operands again and square as well.
+    limbs_mul(r, a, h, b, h);
+    limbs_mul(r+2*h, a+h, na-h, b+h, nb-h);
+    limbs_mul(zm, da, h, db, h);
+
+    // t = a0*b0 + a1*b1 -/+ |a0-a1|*|b0-b1|
+    t[2*h] = limbs_add(t, r, 2*h, r+2*h, n-2*h);
+    if (neg_a == neg_b) {
+      t[2*h] -= limbs_sub_n(t, t, zm, 2*h);
+    } else {
+      t[2*h] += limbs_add_n(t, t, zm, 2*h);
+    }
+    limbs_add_at(r, n, h, t, 2*h+1);
   }
 
-  bool is_zero() {
-    return m_data.size() == 0;
+  /**
+   * Toom-Cook 3-way multiplication, r[0..na+nb) = a[0..na) * b[0..nb).
+   * Requires na >= nb > 2*k, with k = ceil(na/3).
+   *
+   * Both operands are split into three k-limb pieces, seen as polynomials of degree 2,
+   * evaluated at 0, 1, -1, 2 and infinity, multiplied pointwise and interpolated back.
+   * Only the value at -1 can be negative, so it is carried as magnitude plus sign, and the
+   * interpolation is ordered so that all other intermediate values stay non-negative.
+   * Squares only evaluate a and square pointwise.
+   *
+   *
+   *   c0 = v0, c4 = vinf
+   *   c2 = (v1 + vm1)/2 - c0 - c4
+   *   s  = (v1 - vm1)/2                       (= c1 + c3)
+   *   c3 = ((v2 - c0 - 4*c2 - 16*c4)/2 - s)/3
+   *   c1 = s - c3
+   */
+  static void limbs_mul_toom3(internal_type *r, const internal_type *a, size_t na,
+                              const internal_type *b, size_t nb) {
+    const size_t k = (na+2)/3;
+    const size_t a2n = na - 2*k;
+    const size_t b2n = nb - 2*k;
+    const size_t n = na + nb;
+    const size_t vn = 2*k + 2;
+    assert(na >= nb && nb > 2*k);
+
+    ScratchFrame frame;
+    internal_type *pa1 = frame.alloc<internal_type>(6*(k+1) + 4*vn), *pam1 = pa1 + (k+1), *pa2 = pam1 + (k+1);
+    internal_type *pb1 = pa2 + (k+1), *pbm1 = pb1 + (k+1), *pb2 = pbm1 + (k+1);
+    internal_type *v1 = pb2 + (k+1), *vm1 = v1 + vn, *v2 = vm1 + vn, *c2 = v2 + vn;
+
+    // evaluate at 1, -1 and 2. pa2 is used as scratch for a0 + a2 first.
+    const internal_type *a0 = a, *a1 = a+k, *a2 = a+2*k;
+    pa2[k] = limbs_add(pa2, a0, k, a2, a2n);
+    limbs_add(pa1, pa2, k+1, a1, k);
+    bool neg_a = limbs_abs_sub(pam1, pa2, k+1, a1, k);
+    std::copy(a0, a0+k, pa2);
+    pa2[k] = limbs_addmul_1(pa2, a1, k, 2);
+    internal_type c = limbs_addmul_1(pa2, a2, a2n, 4);
+    pa2[k] += limbs_add_1(pa2+a2n, pa2+a2n, k-a2n, c);
+
+    const internal_type *b0 = b, *b1 = b+k, *b2 = b+2*k;
+    bool neg_b = neg_a;
+    if (a == b && na == nb) {
+      pb1 = pa1;
+      pbm1 = pam1;
+      pb2 = pa2;
+    } else {
+      pb2[k] = limbs_add(pb2, b0, k, b2, b2n);
+      limbs_add(pb1, pb2, k+1, b1, k);
+      neg_b = limbs_abs_sub(pbm1, pb2, k+1, b1, k);
+      std::copy(b0, b0+k, pb2);
+      pb2[k] = limbs_addmul_1(pb2, b1, k, 2);
+      c = limbs_addmul_1(pb2, b2, b2n, 4);
+      pb2[k] += limbs_add_1(pb2+b2n, pb2+b2n, k-b2n, c);
+    }
+
+    // pointwise products. v0 and vinf go to their final place in r.
+    const internal_type *v0 = r;
+    const internal_type *vinf = r + 4*k;
+    limbs_mul(r, a0, k, b0, k);
+    limbs_mul(r + 4*k, a2, a2n, b2, b2n);
+    limbs_mul(v1, pa1, k+1, pb1, k+1);
+    limbs_mul(vm1, pam1, k+1, pbm1, k+1);
+    limbs_mul(v2, pa2, k+1, pb2, k+1);
+
+    // interpolation. c2 first, v1 becomes s, vm1 is no longer needed after that.
+    if (neg_a == neg_b) {
+      limbs_add_n(c2, v1, vm1, vn);
+      limbs_sub_n(v1, v1, vm1, vn);
+    } else {
+      limbs_sub_n(c2, v1, vm1, vn);
+      limbs_add_n(v1, v1, vm1, vn);
+    }
+    limbs_rshift(c2, c2, vn, 1);
+    limbs_rshift(v1, v1, vn, 1);
+    limbs_sub(c2, c2, vn, v0, 2*k);
+    limbs_sub(c2, c2, vn, vinf, n - 4*k);
+
+    // c3, computed in v2
+    limbs_sub(v2, v2, vn, v0, 2*k);
+    limbs_submul_1(v2, c2, vn, 4);
+    internal_type borrow = limbs_submul_1(v2, vinf, n - 4*k, 16);
+    limbs_sub_1(v2 + (n - 4*k), v2 + (n - 4*k), vn - (n - 4*k), borrow);
+    limbs_rshift(v2, v2, vn, 1);
+    limbs_sub_n(v2, v2, v1, vn);
+    limbs_divexact_by3(v2, v2, vn);
+
+    // c1 = s - c3
+    limbs_sub_n(v1, v1, v2, vn);
+
+    // recomposition, c0 and c4 are already in place.
+    std::fill(r + 2*k, r + 4*k, internal_type(internal_0));
+    limbs_add_at(r, n, k, v1, vn);
+    limbs_add_at(r, n, 2*k, c2, vn);
+    limbs_add_at(r, n, 3*k, v2, vn);
   }
 
-};
+#ifdef BIGINT_THREADS
+  private:
+  static std::atomic<unsigned>& mul_threads_setting() {
+    static std::atomic<unsigned> threads(0);
+    return threads;
+  }
+
+  public:
+#endif
+  /**
+   * sets the number of threads a multiplication of at least mul_parallel_threshold limbs
+   * may use, including the calling one. 0 (the default) uses all cores, 1 turns threading
+   * off. Without BIGINT_THREADS this has no effect.
+   */
+  static void set_mul_threads(unsigned threads) {
+#ifdef BIGINT_THREADS
+    mul_threads_setting() = threads;
+#else
+    (void)threads;
+#endif
+  }
+
+  /**
+   * the number of threads large multiplications currently use.
+   */
+  static unsigned mul_threads() {
+#ifdef BIGINT_THREADS
+    unsigned threads = mul_threads_setting();
+    if (!threads)
+      threads = std::thread::hardware_concurrency();
+    return threads ? threads : 1;
+#else
+    return 1;
+#endif
+  }
+
+  /**
+   * calls f(0) .. f(count-1), spread over mul_threads() threads. The calls must be
+   * independent of each other. If no more threads can be started, the ones that did start
+   * (or just the calling one) do the remaining work.
+   */
+  template <typename F>
+  static void parallel_for(size_t count, const F &f) {
+#ifdef BIGINT_THREADS
+    const size_t threads = std::min(size_t(mul_threads()), count);
+    if (threads > 1) {
+      std::atomic<size_t> next(0);
+      auto worker = [&]() {
+        for (size_t i; (i = next++) < count;)
+          f(i);
+      };
+      std::vector<std::thread> pool;
+      try {
+        pool.reserve(threads - 1);
+        for (size_t t = 1; t < threads; ++t)
+          pool.emplace_back(worker);
+      } catch (const std::system_error &) {
+      } catch (const std::bad_alloc &) {
+      }
+      worker();
+      for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+      return;
+    }
+#endif
+    for (size_t i = 0; i < count; ++i)
+      f(i);
+  }
+
+  /**
+   * A prime p = c*2^k+1 for the number theoretic transform, along with the constants for
+   * Montgomery arithmetic modulo p (R = 2^internal_bitlen). p must be below R/2, so that
+   * sums of two residues don't overflow and REDC inputs stay below p*R.
+   *
+   * All values handled by the member functions are in Montgomery representation (x*R mod p)
+   * unless noted otherwise.
+   */
+  struct ntt_prime {
+    internal_type p;
+    // -p^-1 mod R
+    internal_type pinv;
+    // R^2 mod p
+    internal_type r2;
+    // 2-adic order of p-1, the largest supported transform is 2^max_log.
+    uint8_t max_log;
+    // generator of the multiplicative group, plain representation
+    internal_type generator;
+
+    ntt_prime(internal_type prime, internal_type g) : p(prime), generator(g) {
+      // newton iteration for the inverse, every step doubles the number of correct bits.
+      internal_type inv = p;
+      for (int i = 0; i < 6; ++i)
+        inv *= 2 - p*inv;
+      pinv = 0 - inv;
+      // R mod p, doubled internal_bitlen times.
+      r2 = (0 - p) % p;
+      for (uint8_t i = 0; i < internal_bitlen; ++i) {
+        r2 <<= 1;
+        if (r2 >= p)
+          r2 -= p;
+      }
+      max_log = 0;
+      while (!(((p-1) >> max_log) & 1))
+        max_log++;
+    }
+
+    /**
+     * montgomery reduction of hi:lo, which must be below p*R. Returns hi:lo * R^-1 mod p.
+     */
+    internal_type reduce(internal_type hi, internal_type lo) const {
+      internal_type m = lo * pinv;
+      internal_type mp_hi;
+      internal_type mp_lo = mul_limb(m, p, mp_hi);
+      // lo + mp_lo is zero mod R, it only produces a carry if lo is not zero.
+      internal_type t = hi + mp_hi + (lo != 0);
+      (void)mp_lo;
+      return t >= p ? t - p : t;
+    }
+
+    internal_type mul(internal_type a, internal_type b) const {
+      internal_type hi;
+      internal_type lo = mul_limb(a, b, hi);
+      return reduce(hi, lo);
+    }
+
+    internal_type add(internal_type a, internal_type b) const {
+      internal_type s = a + b;
+      return s >= p ? s - p : s;
+    }
+
+    internal_type sub(internal_type a, internal_type b) const {
+      return a >= b ? a - b : a + p - b;
+    }
+
+    /**
+     * converts any value below R into montgomery representation.
+     */
+    internal_type to_mont(internal_type x) const {
+      return mul(x, r2);
+    }
+
+    internal_type pow(internal_type base, uint64_t e) const {
+      internal_type result = to_mont(1);
+      while (e) {
+        if (e & 1)
+          result = mul(result, base);
+        base = mul(base, base);
+        e >>= 1;
+      }
+      return result;
+    }
+
+    /**
+     * twiddle factors for a transform of length n = 2^log_n (log_n >= 1). The factors
+     * of the stage with half-length h are stored at tw[h..2h): tw[h+j] = w_2h^j, w_2h being
+     * a primitive 2h-th root of unity (or its inverse).
+     */
+    void twiddles(internal_type *tw, uint8_t log_n, bool inverse, size_t chunks = 1) const {
+      size_t n = (size_t)1 << log_n;
+      internal_type w = pow(to_mont(generator), (p-1) >> log_n);
+      if (inverse)
+        w = pow(w, p-2);
+      // primitive n-th root first, the smaller stages use its powers. Every chunk starts
+      // from its own power of w.
+      size_t h = n/2;
+      const size_t len = h / chunks;
+      parallel_for(chunks, [this, tw, w, h, len](size_t k) {
+        tw[h + k*len] = pow(w, k*len);
+        for (size_t j = k*len + 1; j < (k+1)*len; ++j)
+          tw[h+j] = mul(tw[h+j-1], w);
+      });
+      for (h /= 2; h >= 1; h /= 2) {
+        for (size_t j = 0; j < h; ++j)
+          tw[h+j] = tw[2*h + 2*j];
+      }
+    }
+
+    /**
+     * decimation in frequency transform, natural order in, bit reversed order out.
+     */
+    void forward(internal_type *x, size_t n, const internal_type *tw) const {
+      for (size_t h = n/2; h >= 1; h /= 2) {
+        for (size_t s = 0; s < n; s += 2*h) {
+          for (size_t j = 0; j < h; ++j) {
+            internal_type u = x[s+j], v = x[s+j+h];
+            x[s+j] = add(u, v);
+            x[s+j+h] = mul(sub(u, v), tw[h+j]);
+          }
+        }
+      }
+    }
+
+    /**
+     * decimation in time transform with the inverse twiddles, bit reversed order in,
+     * natural order out. The result is not scaled by 1/n.
+     */
+    void inverse(internal_type *x, size_t n, const internal_type *tw) const {
+      for (size_t h = 1; h < n; h *= 2) {
+        for (size_t s = 0; s < n; s += 2*h) {
+          for (size_t j = 0; j < h; ++j) {
+            internal_type u = x[s+j], v = mul(x[s+j+h], tw[h+j]);
+            x[s+j] = add(u, v);
+            x[s+j+h] = sub(u, v);
+          }
+        }
+      }
+    }
+
+    /**
+     * forward transform in chunks independent pieces of work, chunks must be a power of two
+     * and at most n/2. The first stages have fewer blocks than chunks, their butterflies
+     * are split within the blocks. After that each chunk transforms its own n/chunks values.
+     */
+    void forward(internal_type *x, size_t n, const internal_type *tw, size_t chunks) const {
+      const size_t m = n / chunks;
+      for (size_t h = n/2; h >= m; h /= 2) {
+        const size_t pieces = chunks / (n / (2*h)), len = h / pieces;
+        parallel_for(chunks, [this, x, tw, h, pieces, len](size_t k) {
+          const size_t s = k / pieces * 2*h;
+          for (size_t j = k % pieces * len, end = j + len; j < end; ++j) {
+            internal_type u = x[s+j], v = x[s+j+h];
+            x[s+j] = add(u, v);
+            x[s+j+h] = mul(sub(u, v), tw[h+j]);
+          }
+        });
+      }
+      parallel_for(chunks, [this, x, m, tw](size_t k) {
+        forward(x + k*m, m, tw);
+      });
+    }
+
+    /**
+     * inverse transform in chunks pieces of work, the stages in reverse order of forward().
+     */
+    void inverse(internal_type *x, size_t n, const internal_type *tw, size_t chunks) const {
+      const size_t m = n / chunks;
+      parallel_for(chunks, [this, x, m, tw](size_t k) {
+        inverse(x + k*m, m, tw);
+      });
+      for (size_t h = m; h < n; h *= 2) {
+        const size_t pieces = chunks / (n / (2*h)), len = h / pieces;
+        parallel_for(chunks, [this, x, tw, h, pieces, len](size_t k) {
+          const size_t s = k / pieces * 2*h;
+          for (size_t j = k % pieces * len, end = j + len; j < end; ++j) {
+            internal_type u = x[s+j], v = mul(x[s+j+h], tw[h+j]);
+            x[s+j] = add(u, v);
+            x[s+j+h] = sub(u, v);
+          }
+        });
+      }
+    }
+  };
+
+  /**
+   * the primes for the NTT multiplication, in ascending order. Their product is larger
+   * than 2^186, so the convolution of 64 bit limbs can be recovered exactly for operands
+   * of up to 2^57 limbs.
+   */
+  static const ntt_prime *ntt_primes() {
+    static const ntt_prime primes[3] = {
+      ntt_prime(0x4180000000000001ULL, 3), // 131*2^55+1
+      ntt_prime(0x5700000000000001ULL, 5), // 87*2^56+1
+      ntt_prime(0x6280000000000001ULL, 3), // 197*2^55+1
+    };
+    return primes;
+  }
+
+  /**
+   * number of independent pieces of work for a transform of length n, at least 4 per thread
+   * for a better balance but never shorter than ntt_min_chunk.
+   */
+  static const size_t ntt_min_chunk = 4096;
+  static size_t ntt_chunks(size_t n) {
+    const size_t threads = mul_threads();
+    size_t chunks = 1;
+    while (threads > 1 && chunks < 4*threads && n / chunks >= 2*ntt_min_chunk)
+      chunks *= 2;
+    return chunks;
+  }
+
+  /**
+   * NTT multiplication, r[0..na+nb) = a[0..na) * b[0..nb).
+   *
+   * The limbs are used as coefficients directly. The cyclic convolution is computed modulo
+   * three primes, then the coefficients are recovered with the chinese remainder theorem
+   * (Garner's algorithm) and the carries are propagated through the result. A square
+   * needs only one forward transform per prime.
+   *
+   * From mul_parallel_threshold on every step is cut into chunks for parallel_for. Garner
+   * runs on ranges of the result, the carries out of each range are added in afterwards.
+   */
+  static void limbs_mul_ntt(internal_type *r, const internal_type *a, size_t na,
+                            const internal_type *b, size_t nb) {
+    const ntt_prime *P = ntt_primes();
+    uint8_t log_n = 1;
+    while (((size_t)1 << log_n) < na + nb - 1)
+      log_n++;
+    const size_t n = (size_t)1 << log_n;
+    assert(log_n <= P[0].max_log);
+
+    const bool square = a == b && na == nb;
+    const size_t chunks = std::min(na, nb) >= mul_parallel_threshold ? ntt_chunks(n) : 1;
+    const size_t m = n / chunks;
+    ScratchFrame frame;
+    internal_type *res = frame.alloc<internal_type>(5*n);
+    internal_type *tw = res + 3*n, *fb = tw + n;
+    for (int i = 0; i < 3; ++i) {
+      const ntt_prime &prime = P[i];
+      internal_type *fa = res + i*n;
+      if (square)
+        fb = fa;
+      parallel_for(chunks, [=](size_t k) {
+        // the operands end at ea and eb within this chunk, the rest is zero padding
+        const size_t lo = k*m, hi = lo + m;
+        const size_t ea = std::max(lo, std::min(hi, na)), eb = std::max(lo, std::min(hi, nb));
+        for (size_t j = lo; j < ea; ++j)
+          fa[j] = prime.to_mont(a[j]);
+        std::fill(fa + ea, fa + hi, internal_type(internal_0));
+        if (!square) {
+          for (size_t j = lo; j < eb; ++j)
+            fb[j] = prime.to_mont(b[j]);
+          std::fill(fb + eb, fb + hi, internal_type(internal_0));
+        }
+      });
+      prime.twiddles(tw, log_n, false, chunks);
+      prime.forward(fa, n, tw, chunks);
+      if (!square)
+        prime.forward(fb, n, tw, chunks);
+      parallel_for(chunks, [=](size_t k) {
+        for (size_t j = k*m; j < (k+1)*m; ++j)
+          fa[j] = prime.mul(fa[j], fb[j]);
+      });
+      prime.twiddles(tw, log_n, true, chunks);
+      prime.inverse(fa, n, tw, chunks);
+
+      // scale by 1/n and leave montgomery representation in one step: REDC(xR * n^-1) = x/n.
+      // n * (p - (p-1)/n) = 1 mod p
+      const internal_type n_inv = prime.p - ((prime.p - 1) >> log_n);
+      parallel_for(chunks, [=](size_t k) {
+        const size_t end = std::min((k+1)*m, na + nb - 1);
+        for (size_t j = k*m; j < end; ++j)
+          fa[j] = prime.mul(fa[j], n_inv);
+      });
+    }
+
+    // garner: x = v1 + v2*p1 + v3*p1*p2
+    const ntt_prime &P1 = P[0], &P2 = P[1], &P3 = P[2];
+    const internal_type inv_p1_mod_p2 = P2.pow(P2.to_mont(P1.p), P2.p - 2);
+    internal_type p1p2[2];
+    p1p2[0] = mul_limb(P1.p, P2.p, p1p2[1]);
+    const internal_type p1_mod_p3 = P3.to_mont(P1.p);
+    const internal_type inv_p1p2_mod_p3 = P3.pow(P3.mul(P3.to_mont(P1.p), P3.to_mont(P2.p)), P3.p - 2);
+
+    const size_t len = na + nb, step = (len + chunks - 1) / chunks;
+    // the two limbs each range carries into the next one
+    internal_type *carries = frame.alloc<internal_type>(2*chunks);
+    parallel_for(chunks, [=](size_t k) {
+      internal_type acc[3] = {0, 0, 0};
+      const size_t end = std::min(len, (k+1)*step);
+      for (size_t j = std::min(len, k*step); j < end; ++j) {
+        if (j < len - 1) {
+          const internal_type r1 = res[j], r2 = res[n+j], r3 = res[2*n+j];
+          // inv_p1_mod_p2 is in montgomery form, mul() with a plain value gives a plain value.
+          const internal_type v2 = P2.mul(P2.sub(r2, r1), inv_p1_mod_p2);
+          internal_type t = P3.add(r1, P3.mul(v2, p1_mod_p3));
+          const internal_type v3 = P3.mul(P3.sub(r3, t), inv_p1p2_mod_p3);
+
+          internal_type x[3], hi;
+          x[0] = mul_limb(v2, P1.p, x[1]);
+          x[2] = 0;
+          x[2] += limbs_add_1(x, x, 2, r1);
+          internal_type y[3];
+          y[0] = mul_limb(v3, p1p2[0], y[1]);
+          internal_type lo = mul_limb(v3, p1p2[1], hi);
+          y[1] += lo;
+          y[2] = hi + (y[1] < lo);
+          limbs_add_n(x, x, y, 3);
+          limbs_add_n(acc, acc, x, 3);
+        }
+        r[j] = acc[0];
+        acc[0] = acc[1];
+        acc[1] = acc[2];
+        acc[2] = 0;
+      }
+      carries[2*k] = acc[0];
+      carries[2*k+1] = acc[1];
+    });
+    // the product fits into len limbs, nothing is carried out of the last range.
+    internal_type carry = 0;
+    for (size_t k = 0; k < chunks; ++k) {
+      const size_t end = std::min(len, (k+1)*step);
+      for (size_t c = 0; c < 2; ++c) {
+        if (end + c < len)
+          carry |= limbs_add_1(r + end + c, r + end + c, len - end - c, carries[2*k+c]);
+        else
+          carry |= carries[2*k+c];
+      }
+    }
+    assert(carry == 0);
+    (void)carry;
+  }
+
+  /**
+   * r[0..na+nb) = a[0..na) * b[0..nb), choosing the algorithm from the operand sizes.
+   * na and nb must be at least 1, r must not overlap with a or b.
+   *
+   * Operands of very different length are cut into pieces of the shorter length, so
+   * multiplying by a small number stays linear in the length of the large one and
+   * the balanced algorithms only ever see operands of similar size.
+   */
+  static void limbs_mul(internal_type *r, const internal_type *a, size_t na,
+                        const internal_type *b, size_t nb) {
+    if (a == b && na == nb) {
+      limbs_sqr(r, a, na);
+      return;
+    }
+    if (na < nb) {
+      std::swap(a, b);
+      std::swap(na, nb);
+    }
+
+    if (nb < mul_karatsuba_threshold) {
+      limbs_mul_basecase(r, a, na, b, nb);
+    } else if (nb <= (na+1)/2) {
+      limbs_mul_unbalanced(r, a, na, b, nb);
+    } else if (nb >= mul_ntt_threshold) {
+      limbs_mul_ntt(r, a, na, b, nb);
+    } else if (nb < mul_toom3_threshold || nb <= 2*((na+2)/3)) {
+      limbs_mul_karatsuba(r, a, na, b, nb);
+    } else {
+      limbs_mul_toom3(r, a, na, b, nb);
+    }
+  }
+
+  /**
+   * r[0..2n) = a[0..n)^2, the squaring counterpart of limbs_mul. limbs_mul ends up here
+   * by itself when both operands are the same.
+   */
+  static void limbs_sqr(internal_type *r, const internal_type *a, size_t n) {
+    if (n < sqr_karatsuba_threshold) {
+      limbs_sqr_basecase(r, a, n);
+    } else if (n >= mul_ntt_threshold) {
+      limbs_mul_ntt(r, a, n, a, n);
+    } else if (n < mul_toom3_threshold) {
+      limbs_mul_karatsuba(r, a, n, a, n);
+    } else {
+      limbs_mul_toom3(r, a, n, a, n);
+    }
+  }
+
+  /**
+   * r[0..na+nb) = a[0..na) * b[0..nb) for na > nb, multiplying nb-limb pieces of a with b
+   * and adding up the partial products.
+   */
+  static void limbs_mul_unbalanced(internal_type *r, const internal_type *a, size_t na,
+                                   const internal_type *b, size_t nb) {
+    limbs_mul(r, a, nb, b, nb);
+    ScratchFrame frame;
+    internal_type *tmp = frame.alloc<internal_type>(2*nb);
+    for (size_t off = nb; off < na; off += nb) {
+      size_t len = std::min(nb, na - off);
+      limbs_mul(tmp, a + off, len, b, nb);
+      // the limbs above off+nb have not been written yet
+      std::copy(tmp + nb, tmp + len + nb, r + off + nb);
+      internal_type carry = limbs_add_n(r + off, r + off, tmp, nb);
+      limbs_add_1(r + off + nb, r + off + nb, len, carry);
+    }
+  }
+
+  friend BigInt operator * (const BigInt &a, const BigInt &b) {
+    BigInt target(0);
+    if (!a.m_data.size() || !b.m_data.size())
+      return target;
+
+    // the product needs at most the sum of the operand lengths, the top limb is stripped
+    // by remove_empty_registers if it stays empty.
+    target.m_data.resize(a.m_data.size() + b.m_data.size());
+    limbs_mul(&target.m_data[0], &a.m_data[0], a.m_data.size(), &b.m_data[0], b.m_data.size());
+    target.remove_empty_registers();
+    target.neg = a.neg ^ b.neg;
+    return target;
+  }
+
+  friend BigInt operator * (BigInt &&a, const BigInt &b) {
+    a *= b;
+    return std::move(a);
+  }
+
+  friend BigInt operator * (const BigInt &a, BigInt &&b) {
+    b *= a;
+    return std::move(b);
+  }
+
+  friend BigInt operator * (BigInt &&a, BigInt &&b) {
+    a *= b;
+    return std::move(a);
+  }
+
+  /**
+   * the product goes through scratch memory and is copied back, so the existing buffer
+   * is reused when it's large enough (and other may be *this).
+   */
+  BigInt& operator *= (const BigInt &other) {
+    if (!m_data.size() || !other.m_data.size()) {
+      m_data.clear();
+      neg = false;
+      return *this;
+    }
+    const size_t n = m_data.size() + other.m_data.size();
+    ScratchFrame frame;
+    internal_type *prod = frame.alloc<internal_type>(n);
+    limbs_mul(prod, &m_data[0], m_data.size(), &other.m_data[0], other.m_data.size());
+    m_data.resize(n);
+    std::copy(prod, prod + n, &m_data[0]);
+    remove_empty_registers();
+    neg = neg ^ other.neg;
+    return *this;
+  }
+
+  /**
+   * this * this, with the squaring kernels (about half the work of a product).
+   */
+  BigInt square() const {
+    BigInt result;
+    const size_t n = m_data.size();
+    if (!n)
+      return result;
+    result.m_data.resize(2*n);
+    limbs_sqr(&result.m_data[0], &m_data[0], n);
+    result.remove_empty_registers();
+    return result;
+  }
+
+  /**
+   * number of leading zero bits of x, which must not be zero.
+   */
+  static uint8_t count_leading_zeros(internal_type x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    uint8_t n = 0;
+    while (!(x & (internal_type(1) << (internal_bitlen-1)))) {
+      x <<= 1;
+      n++;
+    }
+    return n;
+#endif
+  }
+
+  /**
+   * number of trailing zero bits of x, which must not be zero.
+   */
+  static uint8_t count_trailing_zeros(internal_type x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    uint8_t n = 0;
+    while (!(x & 1)) {
+      x >>= 1;
+      n++;
+    }
+    return n;
+#endif
+  }
+
+  /**
+   * x with the order of its bytes reversed.
+   */
+  static uint64_t byte_swap(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_bswap64(x);
+#else
+    x = (x >> 32) | (x << 32);
+    x = ((x & 0xffff0000ffff0000ULL) >> 16) | ((x & 0x0000ffff0000ffffULL) << 16);
+    return ((x & 0xff00ff00ff00ff00ULL) >> 8) | ((x & 0x00ff00ff00ff00ffULL) << 8);
+#endif
+  }
+
+  /**
+   * number of set bits of x.
+   */
+  static uint8_t popcount(internal_type x) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    uint8_t n = 0;
+    for (; x; x &= x - 1)
+      n++;
+    return n;
+#endif
+  }
+
+  /**
+   * divides the two limb number hi:lo by d and returns the quotient, the remainder is
+   * written to rem. d must be normalized (highest bit set) and hi < d, so that the
+   * quotient fits into one limb.
+   */
+  static internal_type div_limb(internal_type hi, internal_type lo, internal_type d, internal_type &rem) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 n = ((unsigned __int128)hi << internal_bitlen) | lo;
+    internal_type q = (internal_type)(n / d);
+    rem = lo - q*d;
+    return q;
+#else
+    // long division in half limbs, with knuth's correction of the estimated digits.
+    const uint8_t half = internal_bitlen/2;
+    const internal_type b = internal_type(1) << half;
+    const internal_type d1 = d >> half, d0 = d & (b-1);
+    const internal_type lo1 = lo >> half, lo0 = lo & (b-1);
+
+    internal_type q1 = hi / d1;
+    internal_type rhat = hi - q1*d1;
+    while (q1 >= b || q1*d0 > ((rhat << half) | lo1)) {
+      q1--;
+      rhat += d1;
+      if (rhat >= b)
+        break;
+    }
+    internal_type mid = (hi << half) + lo1 - q1*d;
+
+    internal_type q0 = mid / d1;
+    rhat = mid - q0*d1;
+    while (q0 >= b || q0*d0 > ((rhat << half) | lo0)) {
+      q0--;
+      rhat += d1;
+      if (rhat >= b)
+        break;
+    }
+    rem = (mid << half) + lo0 - q0*d;
+    return (q1 << half) | q0;
+#endif
+  }
+
+  /**
+   * reciprocal of a normalized limb d for div_limb_preinv: floor((B^2 - 1) / d) - B.
+   */
+  static internal_type limb_reciprocal(internal_type d) {
+    internal_type rem;
+    return div_limb(~d, internal_max, d, rem);
+  }
+
+  /**
+   * same as div_limb, but with the reciprocal v of d precomputed (Moeller and Granlund,
+   * "Improved division by invariant integers"). Costs two multiplications instead of a
+   * division, which pays off whenever the same divisor is used more than once.
+   */
+  static internal_type div_limb_preinv(internal_type hi, internal_type lo, internal_type d, internal_type v,
+                                       internal_type &rem) {
+    internal_type q1;
+    internal_type q0 = mul_limb(v, hi, q1);
+    q0 += lo;
+    q1 += hi + 1 + (q0 < lo);
+    internal_type r = lo - q1*d;
+    if (r > q0) {
+      q1--;
+      r += d;
+    }
+    if (r >= d) {
+      q1++;
+      r -= d;
+    }
+    rem = r;
+    return q1;
+  }
+
+  /**
+   * q[0..n) = a[0..n) / d, returns the remainder. d must not be zero, q may alias a.
+   *
+   * d is normalized and the numerator is shifted by the same amount on the fly, which
+   * yields the same quotient digits.
+   */
+  static internal_type limbs_divmod_1(internal_type *q, const internal_type *a, size_t n, internal_type d) {
+    const uint8_t s = count_leading_zeros(d);
+    d <<= s;
+    const internal_type v = limb_reciprocal(d);
+    internal_type rem = 0;
+    if (s) {
+      rem = a[n-1] >> (internal_bitlen - s);
+      for (size_t i = n-1; i > 0; --i) {
+        internal_type digit = (a[i] << s) | (a[i-1] >> (internal_bitlen - s));
+        q[i] = div_limb_preinv(rem, digit, d, v, rem);
+      }
+      q[0] = div_limb_preinv(rem, a[0] << s, d, v, rem);
+    } else {
+      for (size_t i = n; i > 0; --i) {
+        q[i-1] = div_limb_preinv(rem, a[i-1], d, v, rem);
+      }
+    }
+    return rem >> s;
+  }
+
+  /**
+   * returns a[0..n) % d without storing the quotient. d must not be zero.
+   */
+  static internal_type limbs_mod_1(const internal_type *a, size_t n, internal_type d) {
+    const uint8_t s = count_leading_zeros(d);
+    d <<= s;
+    const internal_type v = limb_reciprocal(d);
+    internal_type rem = 0;
+    if (s) {
+      rem = a[n-1] >> (internal_bitlen - s);
+      for (size_t i = n-1; i > 0; --i) {
+        div_limb_preinv(rem, (a[i] << s) | (a[i-1] >> (internal_bitlen - s)), d, v, rem);
+      }
+      div_limb_preinv(rem, a[0] << s, d, v, rem);
+    } else {
+      for (size_t i = n; i > 0; --i) {
+        div_limb_preinv(rem, a[i-1], d, v, rem);
+      }
+    }
+    return rem >> s;
+  }
+
+  /**
+   * Knuth's algorithm D (TAOCP vol. 2, 4.3.1): q[0..na-nd+1) = a / d, r[0..nd) = a % d.
+   * Requires na >= nd >= 2 and d[nd-1] != 0. q and r must not overlap with the inputs.
+   *
+   * Every step estimates one quotient limb from the top two limbs of the remainder and the
+   * top limb of the normalized divisor, refines it with the second divisor limb (after which
+   * it is at most one too large) and subtracts q*d in a single pass.
+   */
+  static void limbs_divmod(internal_type *q, internal_type *r, const internal_type *a, size_t na,
+                           const internal_type *d, size_t nd) {
+    assert(na >= nd && nd >= 2 && d[nd-1] != 0);
+    if (nd >= div_newton_threshold && na - nd >= div_newton_threshold) {
+      limbs_divmod_newton(q, r, a, na, d, nd);
+      return;
+    }
+    const uint8_t s = count_leading_zeros(d[nd-1]);
+
+    ScratchFrame frame;
+    internal_type *un = frame.alloc<internal_type>(na + 1 + nd);
+    internal_type *dn = un + na + 1;
+    if (s) {
+      limbs_lshift(dn, d, nd, s);
+      un[na] = limbs_lshift(un, a, na, s);
+    } else {
+      std::copy(d, d + nd, dn);
+      std::copy(a, a + na, un);
+      un[na] = 0;
+    }
+
+    const internal_type d1 = dn[nd-1], d0 = dn[nd-2];
+    const internal_type v = limb_reciprocal(d1);
+    for (size_t j = na - nd + 1; j-- > 0;) {
+      internal_type *u = un + j;
+      internal_type qhat, rhat;
+      bool rhat_overflow = false;
+      if (u[nd] == d1) {
+        // the estimate would not fit into a limb, start from the largest digit instead.
+        qhat = internal_max;
+        rhat = u[nd-1] + d1;
+        rhat_overflow = rhat < d1;
+      } else {
+        qhat = div_limb_preinv(u[nd], u[nd-1], d1, v, rhat);
+      }
+      while (!rhat_overflow) {
+        internal_type p_hi;
+        internal_type p_lo = mul_limb(qhat, d0, p_hi);
+        if (p_hi < rhat || (p_hi == rhat && p_lo <= u[nd-2]))
+          break;
+        qhat--;
+        rhat += d1;
+        rhat_overflow = rhat < d1;
+      }
+
+      internal_type borrow = limbs_submul_1(u, dn, nd, qhat);
+      internal_type top = u[nd];
+      u[nd] = top - borrow;
+      if (top < borrow) {
+        // qhat was still one too large, add back one divisor.
+        qhat--;
+        u[nd] += limbs_add_n(u, u, dn, nd);
+      }
+      q[j] = qhat;
+    }
+
+    if (s) {
+      limbs_rshift(r, un, nd, s);
+    } else {
+      std::copy(un, un + nd, r);
+    }
+  }
+
+  /**
+   * x[0..n] = floor((B^2n - 1) / d), B = 2^internal_bitlen, for a normalized divisor d[0..n)
+   * (highest bit set). The result has n+1 limbs, the top one is 0 or 1.
+   *
+   * The reciprocal of the upper half of d is computed recursively, then one newton step
+   * X1 = X0 + X0*(B^2n - d*X0)/B^2n doubles its precision. The few units of error left are
+   * corrected against d*X1, so every level returns the exact value.
+   */
+  static void limbs_invert(internal_type *x, const internal_type *d, size_t n) {
+    if (n < div_newton_threshold) {
+      ScratchFrame frame;
+      internal_type *ones = frame.alloc<internal_type>(3*n);
+      internal_type *rem = ones + 2*n;
+      std::fill(ones, ones + 2*n, internal_type(internal_max));
+      limbs_divmod(x, rem, ones, 2*n, d, n);
+      return;
+    }
+
+    const size_t h = (n+1)/2;
+    ScratchFrame frame;
+    internal_type *xh = frame.alloc<internal_type>((h+1) + (2*n+2) + (2*n+h+2));
+    internal_type *t = xh + (h+1);
+    internal_type *p = t + (2*n+2);
+
+    limbs_invert(xh, d + (n-h), h);
+
+    // t = d * X0 with X0 = xh * B^(n-h), compared against B^2n.
+    std::fill(t, t + (n-h), internal_type(internal_0));
+    limbs_mul(t + (n-h), d, n, xh, h+1);
+    bool too_large = t[2*n] != 0;
+    if (too_large) {
+      t[2*n] = 0;
+    } else {
+      // B^2n - t, two's complement over 2n limbs
+      for (size_t i = 0; i < 2*n; ++i)
+        t[i] = ~t[i];
+      limbs_add_1(t, t, 2*n, 1);
+    }
+    size_t en = 2*n;
+    while (en && t[en-1] == 0)
+      --en;
+
+    // X1 = X0 +/- floor(xh * e / B^(n+h))
+    std::fill(x, x + (n-h), internal_type(internal_0));
+    std::copy(xh, xh + h+1, x + (n-h));
+    if (en) {
+      limbs_mul(p, xh, h+1, t, en);
+      const size_t pn = h+1 + en;
+      if (pn > n+h) {
+        if (too_large) {
+          limbs_sub(x, x, n+1, p + (n+h), pn - (n+h));
+        } else {
+          limbs_add(x, x, n+1, p + (n+h), pn - (n+h));
+        }
+      }
+    }
+
+    // exact correction: 0 <= B^2n - 1 - d*X1 < d
+    limbs_mul(t, d, n, x, n+1);
+    while (t[2*n] != 0) {
+      t[2*n] -= limbs_sub(t, t, 2*n, d, n);
+      limbs_sub_1(x, x, n+1, 1);
+    }
+    for (;;) {
+      std::copy(t, t + 2*n, p);
+      if (limbs_add(p, p, 2*n, d, n))
+        break;
+      std::copy(p, p + 2*n, t);
+      limbs_add_1(x, x, n+1, 1);
+    }
+  }
+
+  /**
+   * division by a large divisor using its reciprocal, same contract as limbs_divmod.
+   *
+   * The numerator is processed from the top in blocks of (at most) nd quotient limbs, like
+   * a schoolbook division in base B^nd. Each block of the quotient is estimated from the
+   * top limbs of the current partial remainder times the reciprocal. The estimate is never
+   * too large and at most a few units too small, which is fixed by subtracting d.
+   */
+  static void limbs_divmod_newton(internal_type *q, internal_type *r, const internal_type *a, size_t na,
+                                  const internal_type *d, size_t nd) {
+    const uint8_t s = count_leading_zeros(d[nd-1]);
+    ScratchFrame frame;
+    internal_type *un = frame.alloc<internal_type>((na+1) + nd + (nd+1) + 2*(2*nd+2));
+    internal_type *dn = un + (na+1);
+    internal_type *x = dn + nd;
+    internal_type *p = x + (nd+1);
+    internal_type *qd = p + (2*nd+2);
+    if (s) {
+      limbs_lshift(dn, d, nd, s);
+      un[na] = limbs_lshift(un, a, na, s);
+    } else {
+      std::copy(d, d + nd, dn);
+      std::copy(a, a + na, un);
+      un[na] = 0;
+    }
+
+    limbs_invert(x, dn, nd);
+
+    // un has na+1 limbs, the top nd of them are below dn (see limbs_divmod).
+    size_t pos = na + 1 - nd;
+    while (pos > 0) {
+      const size_t cnt = (pos - 1) % nd + 1;
+      const size_t j = pos - cnt;
+      internal_type *num = un + j;
+
+      limbs_mul(p, num + (nd-1), cnt+1, x, nd+1);
+      internal_type *qe = q + j;
+      std::copy(p + (nd+1), p + (nd+1) + cnt, qe);
+
+      limbs_mul(qd, qe, cnt, dn, nd);
+      internal_type borrow = limbs_sub_n(num, num, qd, cnt + nd);
+      assert(borrow == 0);
+      (void)borrow;
+
+      // the partial remainder is now below a few times d, so it fits into nd+1 limbs.
+      while (num[nd] != 0 || limbs_cmp(num, dn, nd) >= 0) {
+        num[nd] -= limbs_sub_n(num, num, dn, nd);
+        limbs_add_1(qe, qe, cnt, 1);
+      }
+      pos = j;
+    }
+
+    if (s) {
+      limbs_rshift(r, un, nd, s);
+    } else {
+      std::copy(un, un + nd, r);
+    }
+  }
+
+  /**
+   * divide the current object by the denominator parameter and
+   * return the result. The remainder is written to modulo and keeps the sign of
+   * this object, the quotient is always positive.
+   *
+   * Both are computed limb by limb into buffers that are allocated once (see limbs_divmod).
+   */
+  BigInt div_abs(const BigInt &denominator, BigInt &modulo) const {
+    if (denominator.lt_abs(2)) {
+      modulo = BigInt();
+      return BigInt(*this);
+    }
+
+    BigInt quotient(0);
+    if (lt_abs(denominator)) {
+      modulo = *this;
+      return quotient;
+    }
+
+    const size_t na = m_data.size(), nd = denominator.m_data.size();
+    quotient.m_data.resize(na - nd + 1);
+    BigInt remainder(0);
+    remainder.m_data.resize(nd);
+    if (nd == 1) {
+      remainder.m_data[0] = limbs_divmod_1(&quotient.m_data[0], &m_data[0], na, denominator.m_data[0]);
+    } else {
+      limbs_divmod(&quotient.m_data[0], &remainder.m_data[0], &m_data[0], na,
+                   &denominator.m_data[0], nd);
+    }
+    quotient.remove_empty_registers();
+    remainder.remove_empty_registers();
+    if (!remainder.is_zero())
+      remainder.neg = neg;
+    modulo = std::move(remainder);
+    return quotient;
+  }
+
+  BigInt div_abs(const BigInt& denominator) const {
+    BigInt unused_modulo_result(0);
+    return div_abs(denominator, unused_modulo_result);
+  }
+
+  /**
+   * Division, obviously. Dividing by zero is equivalent to dividing by 1.
+   *
+   * The quotient is computed into scratch memory and copied over the dividend, which is
+   * always at least as long, so this never allocates. The result is truncated, its sign
+   * follows the usual rules unless it is zero. Powers of two are a shift.
+   */
+  BigInt& operator /= (const BigInt &denominator) {
+    const bool quotient_neg = neg ^ denominator.neg;
+    const size_t nd = denominator.m_data.size();
+    if (denominator.is_pow2_abs()) {
+      // the shift truncates towards zero as well
+      *this >>= denominator.get_highest_set_bit_position() - 1;
+    } else if (nd == 1) {
+      divmod_limb(denominator.m_data[0]);
+    } else if (nd > 1 && lt_abs(denominator)) {
+      m_data.clear();
+    } else if (nd > 1) {
+      const size_t na = m_data.size();
+      ScratchFrame frame;
+      internal_type *q = frame.alloc<internal_type>(na + 1);
+      limbs_divmod(q, q + (na - nd + 1), &m_data[0], na, &denominator.m_data[0], nd);
+      m_data.resize(na - nd + 1);
+      std::copy(q, q + (na - nd + 1), &m_data[0]);
+      remove_empty_registers();
+    }
+    neg = quotient_neg && !is_zero();
+    return *this;
+  }
+
+  /**
+   * Modulo operation. The sign is taken from the dividend (same as the C++ ISO-2011 standard).
+   * Powers of two only keep the low bits.
+   */
+  BigInt& operator %= (const BigInt &denominator) {
+    const size_t nd = denominator.m_data.size();
+    if (denominator.is_pow2_abs()) {
+      truncate_bits(denominator.get_highest_set_bit_position() - 1);
+    } else if (nd == 1) {
+      internal_type rem = mod_limb(denominator.m_data[0]);
+      m_data.resize(1);
+      m_data[0] = rem;
+      remove_empty_registers();
+    } else if (nd > 1 && !lt_abs(denominator)) {
+      const size_t na = m_data.size();
+      ScratchFrame frame;
+      internal_type *q = frame.alloc<internal_type>(na + 1);
+      internal_type *r = q + (na - nd + 1);
+      limbs_divmod(q, r, &m_data[0], na, &denominator.m_data[0], nd);
+      m_data.resize(nd);
+      std::copy(r, r + nd, &m_data[0]);
+      remove_empty_registers();
+    } else if (nd == 0) {
+      // same as dividing by one
+      m_data.clear();
+      neg = false;
+    }
+    return *this;
+  }
+
+  friend BigInt operator / (const BigInt &a, const BigInt &denominator) {
+    BigInt quotient(a);
+    quotient /= denominator;
+    return quotient;
+  }
+
+  friend BigInt operator / (BigInt &&a, const BigInt &denominator) {
+    a /= denominator;
+    return std::move(a);
+  }
+
+  friend BigInt operator % (const BigInt &a, const BigInt &denominator) {
+    BigInt modulo_result(a);
+    modulo_result %= denominator;
+    return modulo_result;
+  }
+
+  /**
+   * divides this object by d in place (truncating, the sign is kept unless the quotient
+   * is zero) and returns the remainder of the absolute values.
+   * Same as for operator/, dividing by zero is equivalent to dividing by 1.
+   */
+  internal_type divmod_limb(internal_type d) {
+    if (d < 2 || !m_data.size())
+      return 0;
+    internal_type rem = limbs_divmod_1(&m_data[0], &m_data[0], m_data.size(), d);
+    if (!m_data.back())
+      m_data.pop_back();
+    if (!m_data.size())
+      neg = false;
+    return rem;
+  }
+
+  /**
+   * returns |this| % d. A zero d gives 0, same as for divmod_limb.
+   */
+  internal_type mod_limb(internal_type d) const {
+    if (d < 2 || !m_data.size())
+      return 0;
+    return limbs_mod_1(&m_data[0], m_data.size(), d);
+  }
+
+  /**
+   * largest power of radix that fits into a limb, the exponent is written to digits.
+   */
+  static internal_type radix_limb_power(uint8_t radix, uint8_t &digits) {
+    internal_type power = radix;
+    digits = 1;
+    while (power <= internal_max / radix) {
+      power *= radix;
+      digits++;
+    }
+    return power;
+  }
+
+  static char digit_char(internal_type digit, bool uppercase) {
+    if (digit < 10)
+      return '0' + digit;
+    return (uppercase ? 'A' : 'a') + (digit - 10);
+  }
+
+  /**
+   * appends the digits of |x| to out, most significant first. If pad is not zero, exactly
+   * pad digits are written (x must fit), otherwise there are no leading zeros.
+   *
+   * powers[i] holds radix_limb_power^(2^i). Large numbers are split by the power closest
+   * to their square root, the lower half is written with zero padding. Small ones are
+   * converted by dividing out one limb worth of digits at a time.
+   */
+  static void append_digits(std::string &out, const BigInt &x, const std::vector<BigInt> &powers,
+                            uint8_t radix, bool uppercase, size_t pad) {
+    uint8_t digits;
+    const internal_type power = radix_limb_power(radix, digits);
+
+    if (x.m_data.size() >= tostring_dc_threshold && powers.size() > 1) {
+      size_t l = 0;
+      while (l + 1 < powers.size() && 2*powers[l+1].m_data.size() <= x.m_data.size() + 1)
+        l++;
+      BigInt low;
+      BigInt high = x.div_abs(powers[l], low);
+      const size_t low_digits = (size_t)digits << l;
+      append_digits(out, high, powers, radix, uppercase, pad ? pad - low_digits : 0);
+      append_digits(out, low, powers, radix, uppercase, low_digits);
+      return;
+    }
+
+    std::string ret;
+    BigInt copy(x);
+    while (!copy.is_zero()) {
+      internal_type chunk = copy.divmod_limb(power);
+      // all but the most significant chunk are written with leading zeros.
+      const bool top = copy.is_zero();
+      for (uint8_t i = 0; i < digits && !(top && chunk == 0); ++i) {
+        ret.push_back(digit_char(chunk % radix, uppercase));
+        chunk /= radix;
+      }
+    }
+    if (ret.size() < pad)
+      ret.append(pad - ret.size(), '0');
+    out.append(ret.rbegin(), ret.rend());
+  }
+
+  /**
+   * appends the digits of |this| for a power of two radix, reading the bits of each digit
+   * straight from the limbs, most significant digit first.
+   */
+  void append_digits_pow2(std::string &out, uint8_t radix, bool uppercase) const {
+    const char *alphabet = uppercase ? "0123456789ABCDEFGHIJKLMNOPQRSTUV" : "0123456789abcdefghijklmnopqrstuv";
+    uint8_t bits = 0;
+    while ((1 << bits) < radix)
+      bits++;
+
+    const uint64_t n_digits = (get_highest_set_bit_position() + bits - 1) / bits;
+    size_t pos = out.size();
+    out.resize(pos + n_digits);
+    if (radix == 16) {
+      // the top limb only as far as it has digits, then 16 digits per limb.
+      const internal_type top = m_data.back();
+      for (uint64_t j = n_digits - 16*(m_data.size()-1); j > 0; --j)
+        out[pos++] = alphabet[(top >> (4*(j-1))) & 0xf];
+      for (size_t i = m_data.size()-1; i > 0; --i) {
+        const internal_type limb = m_data[i-1];
+        for (int j = 15; j >= 0; --j)
+          out[pos++] = alphabet[(limb >> (4*j)) & 0xf];
+      }
+    } else {
+      for (uint64_t i = n_digits; i > 0; --i) {
+        out[pos++] = alphabet[get_bits_at_pos((i-1)*bits, bits)];
+      }
+    }
+  }
+
+  /**
+   * returns the string representation.
+   * @param radix base to use
+   * @param uppercase whether to use uppercase letters (for radix > 10)
+   */
+  std::string toString(uint8_t radix=10, bool uppercase=false) const {
+    if (is_zero())
+      return "0";
+
+    std::string ret;
+    if (is_neg()) {
+      ret.push_back('-');
+    }
+
+    if (!(radix & (radix-1))) {
+      append_digits_pow2(ret, radix, uppercase);
+      return ret;
+    }
+
+    // radix^(digits*2^i), as long as they are useful for splitting this number.
+    std::vector<BigInt> powers;
+    uint8_t digits;
+    powers.push_back(BigInt(radix_limb_power(radix, digits)));
+    if (m_data.size() >= tostring_dc_threshold) {
+      while (2*powers.back().m_data.size() <= m_data.size() + 1) {
+        powers.push_back(powers.back() * powers.back());
+      }
+    }
+
+    append_digits(ret, BigInt(*this, false), powers, radix, uppercase, 0);
+    return ret;
+  }
+
+  void dump_registers(std::string prefix = "", int fill = 4) const {
+    std::cout << prefix << " " << m_data.size() << " " << (neg?" (-)":" (+)");
+
+    for (;fill > (ssize_t)m_data.size(); --fill) {
+      std::cout << "  0x" << std::setw(sizeof(internal_type)*2) << std::setfill('0') << std::hex << 0x0ULL << std::dec;
+    }
+    for (ssize_t i = m_data.size()-1; i >= 0; --i) {
+      std::cout <<  "  0x" << std::setw(sizeof(internal_type)*2) << std::setfill('0') << std::hex << m_data[i] << std::dec;
+    }
+    std::cout << std::endl;
+  }
+
+  /**
+   * returns the internal representation of the data, without the neg flag.
+   */
+  data_collection_type get_internal_representation() const {
+    return m_data;
+  }
+
+  /**
+   * the limbs without copying them, see limb_span.
+   */
+  limb_span get_limbs() const {
+    return limb_span(m_data.data(), m_data.size());
+  }
+
+  /**
+   * the number of bytes export_bytes writes for |this|: the significant bytes, rounded up to
+   * whole words of word_size bytes. Zero has none.
+   */
+  size_t export_size(size_t word_size = 1) const {
+    const size_t bytes = (get_highest_set_bit_position() + 7) / 8;
+    return (bytes + word_size - 1) / word_size * word_size;
+  }
+
+  /**
+   * writes |this| to out as export_size(word_size) bytes (the sign is not stored), in words
+   * of word_size bytes. word_order says which word comes first, byte_order the order of the
+   * bytes within a word. Returns the number of bytes written.
+   *
+   * Little endian words of little endian bytes are the limbs as they are in memory on most
+   * machines, that is a memcpy. Big endian throughout is the same bytes reversed, whatever
+   * the word size.
+   */
+  size_t export_bytes(uint8_t *out, endianness word_order = big_endian, size_t word_size = 1,
+                      endianness byte_order = big_endian) const {
+    const size_t len = export_size(word_size), bytes = (get_highest_set_bit_position() + 7) / 8;
+    if (word_order == byte_order || word_size == 1) {
+      if (word_order == little_endian) {
+#ifdef BIGINT_LITTLE_ENDIAN
+        if (bytes)
+          std::memcpy(out, m_data.data(), bytes);
+#else
+        for (size_t i = 0; i < bytes; ++i)
+          out[i] = uint8_t(m_data[i / 8] >> (8 * (i % 8)));
+#endif
+        std::fill(out + bytes, out + len, uint8_t(0));
+      } else {
+        // the whole limbs from the end, byte swapped
+        size_t i = 0;
+        for (; i + 8 <= bytes; i += 8) {
+          const uint64_t swapped = byte_swap(m_data[i / 8]);
+          std::memcpy(out + len - i - 8, &swapped, 8);
+        }
+        for (; i < bytes; ++i)
+          out[len - 1 - i] = uint8_t(m_data[i / 8] >> (8 * (i % 8)));
+        std::fill(out, out + len - bytes, uint8_t(0));
+      }
+      return len;
+    }
+    const size_t words = len / word_size;
+    for (size_t i = 0; i < len; ++i) {
+      const size_t word = i / word_size, byte = i % word_size;
+      const size_t pos = (word_order == little_endian ? word : words - 1 - word) * word_size
+                         + (byte_order == little_endian ? byte : word_size - 1 - byte);
+      out[pos] = i < bytes ? uint8_t(m_data[i / 8] >> (8 * (i % 8))) : 0;
+    }
+    return len;
+  }
+
+  /**
+   * export_bytes into a vector of the right size.
+   */
+  std::vector<uint8_t> export_bytes(endianness word_order = big_endian, size_t word_size = 1,
+                                    endianness byte_order = big_endian) const {
+    std::vector<uint8_t> out(export_size(word_size));
+    if (!out.empty())
+      export_bytes(&out[0], word_order, word_size, byte_order);
+    return out;
+  }
+
+  /**
+   * the non-negative number in the len bytes at data, in the layout export_bytes writes
+   * (len must be a multiple of word_size). Leading zero bytes are fine.
+   */
+  static BigInt import_bytes(const uint8_t *data, size_t len, endianness word_order = big_endian,
+                             size_t word_size = 1, endianness byte_order = big_endian) {
+    BigInt result;
+    result.m_data.resize((len + 7) / 8);
+    if (!len)
+      return result;
+    internal_type *r = &result.m_data[0];
+    r[result.m_data.size() - 1] = 0;
+    if (word_order == byte_order || word_size == 1) {
+      if (word_order == little_endian) {
+#ifdef BIGINT_LITTLE_ENDIAN
+        std::memcpy(r, data, len);
+#else
+        for (size_t i = 0; i < len; ++i)
+          r[i / 8] |= internal_type(data[i]) << (8 * (i % 8));
+#endif
+      } else {
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8) {
+          uint64_t limb;
+          std::memcpy(&limb, data + len - i - 8, 8);
+          r[i / 8] = byte_swap(limb);
+        }
+        for (; i < len; ++i)
+          r[i / 8] |= internal_type(data[len - 1 - i]) << (8 * (i % 8));
+      }
+    } else {
+      const size_t words = len / word_size;
+      std::fill(r, r + result.m_data.size(), internal_type(0));
+      for (size_t i = 0; i < len; ++i) {
+        const size_t word = i / word_size, byte = i % word_size;
+        const size_t pos = (word_order == little_endian ? word : words - 1 - word) * word_size
+                           + (byte_order == little_endian ? byte : word_size - 1 - byte);
+        r[i / 8] |= internal_type(data[pos]) << (8 * (i % 8));
+      }
+    }
+    result.remove_empty_registers();
+    return result;
+  }
+
+  bool is_neg() const {
+    return neg;
+  }
+
+  bool is_zero() const {
+    return m_data.size() == 0;
+  }
+
+  private:
+  // the number theory behind gcd, extended_gcd and the perfect power tests.
+
+  /**
+   * gcd of two limbs with Stein's binary algorithm, which gets by with shifts and
+   * subtractions.
+   */
+  static internal_type gcd_limb(internal_type a, internal_type b) {
+    if (!a || !b)
+      return a | b;
+    const uint8_t shift = count_trailing_zeros(a | b);
+    a >>= count_trailing_zeros(a);
+    while (b) {
+      b >>= count_trailing_zeros(b);
+      if (a > b)
+        std::swap(a, b);
+      b -= a;
+    }
+    return a << shift;
+  }
+
+  /**
+   * false if |x| can't be a square, by its residues modulo 64 and modulo a product of
+   * small odd numbers that fits into a limb (63 = 9*7 and the primes 11 to 53). About two
+   * in a hundred thousand non-squares get through.
+   */
+  static bool square_residue_filter(const BigInt &x) {
+    static const internal_type moduli[] = {63, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+    // bit i of residues[j] is set if i is a square modulo moduli[j]
+    struct table {
+      uint64_t residues[sizeof(moduli) / sizeof(moduli[0])];
+      internal_type product = 1;
+      table() {
+        for (size_t j = 0; j < sizeof(moduli) / sizeof(moduli[0]); ++j) {
+          residues[j] = 0;
+          for (internal_type i = 0; i < moduli[j]; ++i)
+            residues[j] |= uint64_t(1) << (i*i % moduli[j]);
+          product *= moduli[j];
+        }
+      }
+    };
+    static const table t;
+    if (x.is_zero())
+      return true;
+    // squares modulo 64 are 0, 1, 4, 9, 16, 17, 25, 33, 36, 41, 49 and 57
+    if (!((0x0202021202030213ULL >> (x.m_data[0] % 64)) & 1))
+      return false;
+    const internal_type r = x.mod_limb(t.product);
+    for (size_t j = 0; j < sizeof(moduli) / sizeof(moduli[0]); ++j) {
+      if (!((t.residues[j] >> (r % moduli[j])) & 1))
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * false if |x| can't be a p-th power, p an odd prime. The p-th powers modulo a prime
+   * q = 1 (mod p) are 0 and the r with r^((q-1)/p) = 1, about one residue in p. A few such
+   * q below 2^32 are tried.
+   */
+  static bool power_residue_filter(const BigInt &x, uint64_t p) {
+    size_t tried = 0;
+    for (uint64_t q = 2*p + 1; q < (uint64_t(1) << 32) && tried < 4; q += 2*p) {
+      if (!is_prime_limb(q))
+        continue;
+      tried++;
+      const internal_type r = x.mod_limb(q);
+      if (r && pow_mod_limb(r, (q - 1) / p, q) != 1)
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * b^e mod m for m below 2^32, so products fit into a limb.
+   */
+  static internal_type pow_mod_limb(internal_type b, internal_type e, internal_type m) {
+    internal_type result = 1 % m;
+    b %= m;
+    for (; e; e >>= 1) {
+      if (e & 1)
+        result = result * b % m;
+      b = b * b % m;
+    }
+    return result;
+  }
+
+  /**
+   * primality of n by trial division, for small n.
+   */
+  static bool is_prime_limb(internal_type n) {
+    if (n < 4)
+      return n >= 2;
+    if (n % 2 == 0 || n % 3 == 0)
+      return false;
+    for (internal_type d = 5; d <= n / d; d += 6) {
+      if (n % d == 0 || n % (d + 2) == 0)
+        return false;
+    }
+    return true;
+  }
+
+  // two limbs of leading bits for Lehmer's gcd on large numbers, if the compiler has them.
+#ifdef __SIZEOF_INT128__
+  typedef unsigned __int128 lehmer_type;
+#else
+  typedef internal_type lehmer_type;
+#endif
+
+  /**
+   * the inner loop of Lehmer's gcd. x >= y are the leading bits of two numbers a >= b, taken
+   * at the same position, and x must leave the top bit of W clear. Euclid runs on x and y
+   * for as long as the quotients are sure to be the ones of a and b (Jebelean's condition),
+   * the cofactors stay at half the width of W. Returns the number of steps k, with
+   * m = {A, B, C, D} the remainders of a and b that far down are
+   *   A*a - B*b, D*b - C*a  for even k,
+   *   A*b - B*a, D*a - C*b  for odd k.
+   */
+  template <typename W>
+  static size_t lehmer_cofactors(W x, W y, internal_type m[4]) {
+    const W cofactor_max = (W(1) << (sizeof(W) * 4)) - 1;
+    W A = 1, B = 0, C = 0, D = 1;
+    size_t k = 0;
+    while (y != C) {
+      // the largest quotient the full numbers could have, taken if it still leaves
+      // x - q*y >= B + q*D. Most quotients are 1 or 2, those don't need a division.
+      const W num = x + (A - 1), den = y - C;
+      W q = 1, rest = num - den;
+      if (rest >= den) {
+        q = rest - den >= den ? num / den : 2;
+        // q*(y - C) <= num and C, D are at most half as wide as x, so the product can't
+        // overflow for q below a quarter of the width.
+        if (q >> (sizeof(W) * 2) ? q > (x - B) / (y + D) : q*(y + D) > x - B)
+          break;
+      } else if (x - y < B + D) {
+        break;
+      }
+      const W s = B + q*D, t = x - q*y, u = A + q*C;
+      if (s > cofactor_max || u > cofactor_max)
+        break;
+      x = y;
+      y = t;
+      A = D;
+      B = C;
+      C = s;
+      D = u;
+      ++k;
+    }
+    m[0] = internal_type(A);
+    m[1] = internal_type(B);
+    m[2] = internal_type(C);
+    m[3] = internal_type(D);
+    return k;
+  }
+
+  /**
+   * one step of Lehmer's gcd on a[0..n) >= b[0..n) (b may have leading zero limbs), n >= 2.
+   * The leading bits decide as many quotients as they can, and a and b are replaced by the
+   * remainders that many Euclid steps further down, which stay in the same order. Returns
+   * the number of steps with the cofactors in m, see lehmer_cofactors. Nothing changes if
+   * the leading bits can't even decide the first quotient.
+   *
+   * Below gcd_lehmer2_threshold limbs a single limb of leading bits is faster, its steps
+   * are shorter but cheaper, above that the passes over a and b dominate.
+   */
+  static size_t limbs_lehmer_step(internal_type *a, internal_type *b, size_t n, internal_type m[4]) {
+    const uint64_t bits = uint64_t(n) * internal_bitlen - count_leading_zeros(a[n-1]);
+    const bool wide = n >= gcd_lehmer2_threshold;
+    const uint64_t lead = (wide ? sizeof(lehmer_type) : sizeof(internal_type)) * 8 - 1;
+    const uint64_t pos = bits > lead ? bits - lead : 0;
+    const size_t k = wide
+        ? lehmer_cofactors(lehmer_bits<lehmer_type>(a, n, pos), lehmer_bits<lehmer_type>(b, n, pos), m)
+        : lehmer_cofactors(lehmer_bits<internal_type>(a, n, pos), lehmer_bits<internal_type>(b, n, pos), m);
+    if (!k)
+      return 0;
+
+    ScratchFrame frame;
+    internal_type *ta = frame.alloc<internal_type>(2*n), *tb = ta + n;
+    const internal_type *p = k % 2 ? b : a, *q = k % 2 ? a : b;
+    internal_type hi_a = limbs_mul_1(ta, p, n, m[0]);
+    hi_a -= limbs_submul_1(ta, q, n, m[1]);
+    internal_type hi_b = limbs_mul_1(tb, q, n, m[3]);
+    hi_b -= limbs_submul_1(tb, p, n, m[2]);
+    // the remainders are smaller than a
+    assert(!hi_a && !hi_b);
+    (void)hi_a;
+    (void)hi_b;
+    std::copy(ta, ta + n, a);
+    std::copy(tb, tb + n, b);
+    return k;
+  }
+
+  /**
+   * bits pos and up of a[0..n), as many as fit into W.
+   */
+  template <typename W>
+  static W lehmer_bits(const internal_type *a, size_t n, uint64_t pos) {
+    const size_t idx = pos / internal_bitlen, words = sizeof(W) / sizeof(internal_type);
+    const uint8_t bit = pos % internal_bitlen;
+    W x = 0;
+    for (size_t i = 0; i < words && idx + i < n; ++i) {
+      internal_type w = a[idx + i] >> bit;
+      if (bit && idx + i + 1 < n)
+        w |= a[idx + i + 1] << (internal_bitlen - bit);
+      x |= W(w) << (internal_bitlen * i);
+    }
+    return x;
+  }
+
+  /**
+   * the row operation (x, y) -> (m0*x + m2*y, m1*x + m3*y), m is stored by columns.
+   */
+  static void gcd_apply(const BigInt m[4], BigInt &x, BigInt &y) {
+    BigInt x2 = m[0]*x + m[2]*y;
+    y = m[1]*x + m[3]*y;
+    x = std::move(x2);
+  }
+
+  /**
+   * (x, y) -> (y, x - q*y), the row operation of one Euclid step.
+   */
+  static void gcd_apply_quotient(const BigInt &q, BigInt &x, BigInt &y) {
+    x -= q*y;
+    std::swap(x, y);
+  }
+
+  /**
+   * the row operation of k Euclid steps with the cofactors m, see lehmer_cofactors. The
+   * pairs Euclid works on have opposite signs (or a zero), then the magnitudes only add up
+   * and it's done on the limbs. Others, from the fixups of half_gcd, take the long way.
+   */
+  static void gcd_apply_cofactors(const internal_type m[4], size_t k, BigInt &x, BigInt &y) {
+    BigInt &p = k % 2 ? y : x, &q = k % 2 ? x : y;
+    if (x.neg == y.neg && !x.is_zero() && !y.is_zero()) {
+      const BigInt A(m[0]), B(m[1]), C(m[2]), D(m[3]);
+      BigInt x2 = A*p - B*q;
+      y = D*q - C*p;
+      x = std::move(x2);
+      return;
+    }
+    // A*p - B*q has the sign of p, or of -q if p is zero, D*q - C*p the other way around
+    const bool neg_x = p.is_zero() ? !q.neg : p.neg, neg_y = q.is_zero() ? !p.neg : q.neg;
+    const size_t n = std::max(x.m_data.size(), y.m_data.size()) + 1;
+    ScratchFrame frame;
+    internal_type *pp = frame.alloc<internal_type>(4*n), *pq = pp + n, *tx = pq + n, *ty = tx + n;
+    std::fill(pp, pp + 2*n, internal_type(0));
+    std::copy(p.m_data.begin(), p.m_data.end(), pp);
+    std::copy(q.m_data.begin(), q.m_data.end(), pq);
+    // the top limbs of p and q are zero, so a carry out of them is at most one
+    internal_type hi_x = limbs_mul_1(tx, pp, n, m[0]);
+    hi_x += limbs_addmul_1(tx, pq, n, m[1]);
+    internal_type hi_y = limbs_mul_1(ty, pq, n, m[3]);
+    hi_y += limbs_addmul_1(ty, pp, n, m[2]);
+    x.m_data.resize(n + 1);
+    std::copy(tx, tx + n, x.m_data.begin());
+    x.m_data[n] = hi_x;
+    y.m_data.resize(n + 1);
+    std::copy(ty, ty + n, y.m_data.begin());
+    y.m_data[n] = hi_y;
+    x.remove_empty_registers();
+    y.remove_empty_registers();
+    x.neg = neg_x && !x.is_zero();
+    y.neg = neg_y && !y.is_zero();
+  }
+
+  /**
+   * makes a and b non-negative with a >= b after a row operation that doesn't keep them
+   * that way by itself, rows[0..pairs) see the same sign changes and swap.
+   */
+  static void gcd_normalize(BigInt &a, BigInt &b, BigInt *rows, size_t pairs) {
+    for (size_t row = 0; row < 2; ++row) {
+      BigInt &x = row ? b : a;
+      if (!x.neg)
+        continue;
+      x.neg = false;
+      for (size_t i = 0; i < pairs; ++i) {
+        BigInt &r = rows[2*i + row];
+        r.neg = !r.neg && !r.is_zero();
+      }
+    }
+    if (a.lt_abs(b)) {
+      std::swap(a, b);
+      for (size_t i = 0; i < pairs; ++i)
+        std::swap(rows[2*i], rows[2*i+1]);
+    }
+  }
+
+  /**
+   * Euclid's algorithm on a and b, which must be non-negative: Euclid steps are taken until
+   * b has at most stop_bits bits (until b is zero for 0, then a is the gcd). a >= b holds
+   * afterwards.
+   *
+   * rows points to pairs numbers (x, y) that see the same row operations as (a, b). Started
+   * as (1, 0), a pair ends up with the cofactors of the original a in the new a and b.
+   *
+   * Lehmer steps do most of the work, they take half a limb or a limb of quotients at a time
+   * from the leading bits. Once b fits into a limb it's finished with the binary gcd, or with
+   * Euclid on the limbs if there are rows. With stop_bits zero, numbers of gcd_hgcd_threshold
+   * limbs and more are brought down with half_gcd first.
+   */
+  static void gcd_reduce(BigInt &a, BigInt &b, uint64_t stop_bits, BigInt *rows, size_t pairs) {
+    gcd_normalize(a, b, rows, pairs);
+    while (b.get_highest_set_bit_position() > stop_bits) {
+      const size_t n = a.m_data.size(), nb = b.m_data.size();
+      if (nb == 1 && !pairs && !stop_bits) {
+        a = BigInt(gcd_limb(b.m_data[0], a.mod_limb(b.m_data[0])));
+        b = BigInt();
+        return;
+      }
+      if (n == 1) {
+        // both in a limb, then Euclid runs on the limbs directly. The cofactors of all its
+        // steps fit into limbs as well (they stay below a / gcd) and go to the rows at once.
+        internal_type x = a.m_data[0], y = b.m_data[0], cof[4] = {1, 0, 0, 1};
+        size_t k = 0;
+        while (y && uint64_t(internal_bitlen - count_leading_zeros(y)) > stop_bits) {
+          const internal_type q = x / y, t = x - q*y, s = cof[1] + q*cof[3], u = cof[0] + q*cof[2];
+          x = y;
+          y = t;
+          cof[0] = cof[3];
+          cof[1] = cof[2];
+          cof[2] = s;
+          cof[3] = u;
+          ++k;
+        }
+        a = BigInt(x);
+        b = BigInt(y);
+        for (size_t i = 0; i < pairs; ++i)
+          gcd_apply_cofactors(cof, k, rows[2*i], rows[2*i+1]);
+        return;
+      }
+
+      if (!stop_bits && nb >= gcd_hgcd_threshold && nb + 1 >= n) {
+        BigInt m[4];
+        half_gcd(a, b, m);
+        for (size_t i = 0; i < pairs; ++i)
+          gcd_apply(m, rows[2*i], rows[2*i+1]);
+        continue;
+      }
+
+      internal_type cof[4];
+      if (n >= 2 && nb + 1 >= n) {
+        b.m_data.resize(n);
+        const size_t k = limbs_lehmer_step(&a.m_data[0], &b.m_data[0], n, cof);
+        a.remove_empty_registers();
+        b.remove_empty_registers();
+        if (k) {
+          for (size_t i = 0; i < pairs; ++i)
+            gcd_apply_cofactors(cof, k, rows[2*i], rows[2*i+1]);
+          continue;
+        }
+      }
+
+      // a plain Euclid step, for quotients too large for the leading bits
+      if (pairs) {
+        BigInt r;
+        const BigInt q = a.div_abs(b, r);
+        a = std::move(r);
+        for (size_t i = 0; i < pairs; ++i)
+          gcd_apply_quotient(q, rows[2*i], rows[2*i+1]);
+      } else {
+        a %= b;
+      }
+      std::swap(a, b);
+    }
+  }
+
+  /**
+   * half gcd: reduces a >= b >= 0 by Euclid steps until b has about half as many bits as a
+   * had (a limb more), and returns the steps as the matrix m (stored by columns, see
+   * gcd_apply) that takes the old a and b to the new ones.
+   *
+   * The steps are taken on the top half of the numbers, recursively, and the matrix is
+   * applied to the whole numbers at once with the subquadratic multiplication. That brings
+   * them down by a quarter, the top part of what is left gives the next quarter. Near the
+   * end the leading bits may pick a quotient that's off by one, the result is fixed up by
+   * signs and order then, the matrix has determinant +-1 either way, so the gcd is kept.
+   */
+  static void half_gcd(BigInt &a, BigInt &b, BigInt m[4]) {
+    m[0] = BigInt(1ULL);
+    m[1] = BigInt();
+    m[2] = BigInt();
+    m[3] = BigInt(1ULL);
+    const uint64_t bits = a.get_highest_set_bit_position();
+    const uint64_t target = bits / 2 + internal_bitlen;
+    while (b.get_highest_set_bit_position() > target) {
+      const uint64_t na = a.get_highest_set_bit_position();
+      // the top part needs twice the bits that still have to go, it's never more than half
+      // of the original size.
+      const uint64_t part = std::min(2*(na - target), bits / 2);
+      if (a.m_data.size() < gcd_hgcd_threshold || part < 16 * internal_bitlen) {
+        gcd_reduce(a, b, target, m, 2);
+        return;
+      }
+      BigInt ta = a >> (na - part), tb = b >> (na - part);
+      BigInt sub[4];
+      half_gcd(ta, tb, sub);
+      if (sub[1].is_zero() && sub[2].is_zero()) {
+        // nothing to take from the top part, the quotient is too large for it
+        BigInt r;
+        const BigInt q = a.div_abs(b, r);
+        a = std::move(r);
+        std::swap(a, b);
+        gcd_apply_quotient(q, m[0], m[1]);
+        gcd_apply_quotient(q, m[2], m[3]);
+        continue;
+      }
+      gcd_apply(sub, a, b);
+      gcd_apply(sub, m[0], m[1]);
+      gcd_apply(sub, m[2], m[3]);
+      gcd_normalize(a, b, m, 2);
+    }
+  }
+};
+
+/**
+ * base^exp by left to right square and multiply, pow(x, 0) is 1 (for x = 0 as well).
+ */
+inline BigInt pow(const BigInt &base, uint64_t exp) {
+  if (!exp)
+    return BigInt(1ULL);
+  BigInt result(base);
+  for (uint8_t i = 63 - BigInt::count_leading_zeros(exp); i-- > 0;) {
+    result = result.square();
+    if ((exp >> i) & 1)
+      result *= base;
+  }
+  // the sign works out by itself, odd exponents end with a multiplication by base.
+  return result;
+}
+
+/**
+ * Montgomery arithmetic modulo a fixed odd n > 1, with R = 2^(64*k) for the k limbs of n.
+ *
+ * Values in Montgomery form are x*R mod n. The product of two of them is brought back
+ * to that form by REDC, which divides by R with k multiply-add passes instead of a
+ * division. The context precomputes n' = -n^-1 mod 2^64 and R^2 mod n once, so converting
+ * into Montgomery form is a multiplication as well.
+ *
+ * The sign of the modulus is ignored, results are always in [0, n).
+ */
+class MontgomeryContext {
+  public:
+  typedef BigInt::internal_type internal_type;
+
+  private:
+  BigInt m_modulus;
+  size_t m_size;
+  // -n^-1 mod 2^64
+  internal_type m_ninv;
+  // R^2 mod n and R mod n (the Montgomery form of 1), both padded to m_size limbs
+  BigInt::data_collection_type m_r2;
+  BigInt::data_collection_type m_one;
+
+  /**
+   * copies x, which must be below n, into r[0..m_size) with zero padding.
+   */
+  void load(internal_type *r, const BigInt &x) const {
+    std::copy(x.m_data.begin(), x.m_data.end(), r);
+    std::fill(r + x.m_data.size(), r + m_size, internal_type(BigInt::internal_0));
+  }
+
+  static BigInt store(const internal_type *a, size_t n) {
+    BigInt result;
+    result.m_data.resize(n);
+    std::copy(a, a + n, &result.m_data[0]);
+    result.remove_empty_registers();
+    return result;
+  }
+
+  /**
+   * x mod n in [0, n), for any x.
+   */
+  BigInt reduce(const BigInt &x) const {
+    BigInt r(x);
+    if (!r.lt_abs(m_modulus))
+      r %= m_modulus;
+    if (r.neg)
+      r += m_modulus;
+    return r;
+  }
+
+  public:
+  explicit MontgomeryContext(const BigInt &modulus) : m_modulus(modulus, false) {
+    m_size = m_modulus.m_data.size();
+    assert(m_size && (m_modulus.m_data[0] & 1) && !(m_size == 1 && m_modulus.m_data[0] == 1));
+
+    // newton iteration for the inverse of the lowest limb, see ntt_prime.
+    const internal_type n0 = m_modulus.m_data[0];
+    internal_type inv = n0;
+    for (int i = 0; i < 6; ++i)
+      inv *= 2 - n0*inv;
+    m_ninv = 0 - inv;
+
+    BigInt one(1ULL);
+    one <<= m_size * BigInt::internal_bitlen;
+    BigInt r2(one * one);
+    one %= m_modulus;
+    r2 %= m_modulus;
+    m_one.resize(m_size);
+    load(&m_one[0], one);
+    m_r2.resize(m_size);
+    load(&m_r2[0], r2);
+  }
+
+  const BigInt& modulus() const {
+    return m_modulus;
+  }
+
+  /**
+   * REDC: r[0..k) = t[0..2k) * R^-1 mod n, for t < n*R. t is destroyed.
+   *
+   * Every pass adds a multiple of n that clears the lowest remaining limb of t. The carry
+   * out of a pass belongs k limbs further up, it is parked in the limb that was just
+   * cleared and all of them are added in one go at the end. The sum is below 2n, so one
+   * conditional subtraction finishes the job.
+   */
+  static void redc(internal_type *r, internal_type *t, const internal_type *n, size_t k, internal_type ninv) {
+    for (size_t i = 0; i < k; ++i) {
+      const internal_type m = t[i] * ninv;
+      t[i] = BigInt::limbs_addmul_1(t + i, n, k, m);
+    }
+    internal_type carry = BigInt::limbs_add_n(r, t + k, t, k);
+    if (carry || BigInt::limbs_cmp(r, n, k) >= 0)
+      BigInt::limbs_sub_n(r, r, n, k);
+  }
+
+  /**
+   * r = a*b*R^-1 mod n on padded m_size limb operands. r may alias a or b.
+   */
+  void mul(internal_type *r, const internal_type *a, const internal_type *b) const {
+    ScratchFrame frame;
+    internal_type *t = frame.alloc<internal_type>(2*m_size);
+    BigInt::limbs_mul(t, a, m_size, b, m_size);
+    redc(r, t, &m_modulus.m_data[0], m_size, m_ninv);
+  }
+
+  /**
+   * x*R mod n.
+   */
+  BigInt to_montgomery(const BigInt &x) const {
+    ScratchFrame frame;
+    internal_type *a = frame.alloc<internal_type>(m_size);
+    load(a, reduce(x));
+    mul(a, a, &m_r2[0]);
+    return store(a, m_size);
+  }
+
+  /**
+   * x*R^-1 mod n, the inverse of to_montgomery for x in [0, n).
+   */
+  BigInt from_montgomery(const BigInt &x) const {
+    ScratchFrame frame;
+    internal_type *t = frame.alloc<internal_type>(3*m_size);
+    internal_type *r = t + 2*m_size;
+    load(t, x);
+    std::fill(t + m_size, t + 2*m_size, internal_type(BigInt::internal_0));
+    redc(r, t, &m_modulus.m_data[0], m_size, m_ninv);
+    return store(r, m_size);
+  }
+
+  /**
+   * a*b*R^-1 mod n for a and b in [0, n), the product of two values in Montgomery form.
+   */
+  BigInt mul(const BigInt &a, const BigInt &b) const {
+    ScratchFrame frame;
+    internal_type *x = frame.alloc<internal_type>(2*m_size);
+    internal_type *y = x + m_size;
+    load(x, a);
+    load(y, b);
+    mul(x, x, y);
+    return store(x, m_size);
+  }
+
+  /**
+   * base^exp mod n. The exponent is used by its absolute value.
+   *
+   * Left to right sliding window: runs of zero bits cost one squaring each, every window
+   * of up to w bits that starts and ends with a one costs its squarings plus a single
+   * multiplication with an odd power from the table.
+   */
+  BigInt pow(const BigInt &base, const BigInt &exp) const {
+    const uint64_t bits = exp.get_highest_set_bit_position();
+    if (!bits)
+      return reduce(BigInt(1ULL));
+
+    const uint8_t w = bits > 768 ? 6 : bits > 256 ? 5 : bits > 80 ? 4 : bits > 24 ? 3 : bits > 6 ? 2 : 1;
+    const size_t k = m_size;
+    ScratchFrame frame;
+    // table[i] = base^(2i+1), then the accumulator and base^2.
+    internal_type *table = frame.alloc<internal_type>(((size_t(1) << (w-1)) + 2) * k);
+    internal_type *acc = table + (size_t(1) << (w-1)) * k;
+    internal_type *sq = acc + k;
+    load(table, reduce(base));
+    mul(table, table, &m_r2[0]);
+    if (w > 1) {
+      mul(sq, table, table);
+      for (size_t i = 1; i < (size_t(1) << (w-1)); ++i)
+        mul(table + i*k, table + (i-1)*k, sq);
+    }
+
+    bool first = true;
+    int64_t i = bits - 1;
+    while (i >= 0) {
+      if (!exp.get_bits_at_pos(i, 1)) {
+        mul(acc, acc, acc);
+        --i;
+        continue;
+      }
+      // the window [j, i] ends with a set bit as well.
+      int64_t j = std::max<int64_t>(i - w + 1, 0);
+      while (!exp.get_bits_at_pos(j, 1))
+        ++j;
+      const internal_type window = exp.get_bits_at_pos(j, i - j + 1);
+      if (first) {
+        std::copy(table + (window >> 1) * k, table + (window >> 1) * k + k, acc);
+        first = false;
+      } else {
+        for (int64_t s = 0; s <= i - j; ++s)
+          mul(acc, acc, acc);
+        mul(acc, acc, table + (window >> 1) * k);
+      }
+      i = j - 1;
+    }
+
+    // leave Montgomery form
+    internal_type *t = frame.alloc<internal_type>(2*k);
+    std::copy(acc, acc + k, t);
+    std::fill(t + k, t + 2*k, internal_type(BigInt::internal_0));
+    redc(acc, t, &m_modulus.m_data[0], k, m_ninv);
+    return store(acc, k);
+  }
+};
+
+/**
+ * Barrett reduction modulo a fixed n > 0, for reducing many values by the same (possibly
+ * even) modulus.
+ *
+ * With k the number of limbs of n and B = 2^64, the context precomputes
+ * mu = floor(B^2k / n). For x < B^2k, which covers the product of any two reduced values,
+ * the quotient estimate q = floor(floor(x / B^(k-1)) * mu / B^(k+1)) is at most two below
+ * the real one. So x mod n is x - q*n with a few corrections, and it only costs two
+ * multiplications. Larger inputs fall back to operator%.
+ *
+ * For small moduli only the parts of the two products that are actually used get
+ * computed: the high half of q1*mu and the low k+1 limbs of q*n.
+ *
+ * The sign of the modulus is ignored, results are always in [0, n).
+ */
+class BarrettContext {
+  public:
+  typedef BigInt::internal_type internal_type;
+  // modulus size (in limbs) up to which the truncated schoolbook products are used.
+  static const size_t short_product_threshold = 64;
+
+  private:
+  BigInt m_modulus;
+  size_t m_size;
+  BigInt m_mu;
+
+  /**
+   * r[0..na+nb) = a*b, except that the partial products below limb skip are left out.
+   * Requires na >= nb. The result is too small by less than nb*B^(skip+1), so only the
+   * limbs well above skip are meaningful.
+   */
+  static void mul_high_basecase(internal_type *r, const internal_type *a, size_t na,
+                                const internal_type *b, size_t nb, size_t skip) {
+    std::fill(r, r + na + nb, internal_type(BigInt::internal_0));
+    for (size_t i = 0; i < nb; ++i) {
+      const size_t j = skip > i ? std::min(skip - i, na) : 0;
+      r[i + na] = BigInt::limbs_addmul_1(r + i + j, a + j, na - j, b[i]);
+    }
+  }
+
+  /**
+   * r[0..n) = (a*b) mod B^n, for na, nb <= n.
+   */
+  static void mul_low_basecase(internal_type *r, const internal_type *a, size_t na,
+                               const internal_type *b, size_t nb, size_t n) {
+    std::fill(r, r + n, internal_type(BigInt::internal_0));
+    for (size_t i = 0; i < nb; ++i) {
+      const size_t len = std::min(na, n - i);
+      const internal_type carry = BigInt::limbs_addmul_1(r + i, a, len, b[i]);
+      if (i + len < n)
+        r[i + len] = carry;
+    }
+  }
+
+  /**
+   * r[0..k) = x[0..nx) mod n, for nx <= 2k.
+   */
+  void reduce_limbs(internal_type *r, const internal_type *x, size_t nx) const {
+    const size_t k = m_size;
+    const internal_type *n = &m_modulus.m_data[0];
+    assert(nx <= 2*k);
+    if (nx < k) {
+      std::copy(x, x + nx, r);
+      std::fill(r + nx, r + k, internal_type(BigInt::internal_0));
+      return;
+    }
+
+    ScratchFrame frame;
+    const size_t nmu = m_mu.m_data.size();
+    const size_t nq1 = nx - (k-1);
+    const bool basecase = k < short_product_threshold;
+    internal_type *q2 = frame.alloc<internal_type>(nq1 + nmu);
+    if (basecase) {
+      // the columns below k-1 change q3 by less than one.
+      mul_high_basecase(q2, &m_mu.m_data[0], nmu, x + (k-1), nq1, k-1);
+    } else {
+      BigInt::limbs_mul(q2, x + (k-1), nq1, &m_mu.m_data[0], nmu);
+    }
+    const internal_type *q3 = q2 + (k+1);
+    size_t nq3 = nq1 + nmu - (k+1);
+    while (nq3 && !q3[nq3-1])
+      --nq3;
+
+    // everything from here on is mod B^(k+1), the remainder fits and borrows out of the
+    // top are meaningless.
+    internal_type *rem = frame.alloc<internal_type>(k+1);
+    const size_t nlow = std::min(nx, k+1);
+    std::copy(x, x + nlow, rem);
+    std::fill(rem + nlow, rem + k+1, internal_type(BigInt::internal_0));
+    if (nq3) {
+      internal_type *qn = frame.alloc<internal_type>(nq3 + k);
+      if (basecase) {
+        mul_low_basecase(qn, n, k, q3, std::min(nq3, k+1), k+1);
+      } else {
+        BigInt::limbs_mul(qn, q3, nq3, n, k);
+      }
+      BigInt::limbs_sub_n(rem, rem, qn, k+1);
+    }
+    while (rem[k] || BigInt::limbs_cmp(rem, n, k) >= 0)
+      rem[k] -= BigInt::limbs_sub_n(rem, rem, n, k);
+    std::copy(rem, rem + k, r);
+  }
+
+  BigInt store(const internal_type *a) const {
+    BigInt result;
+    result.m_data.resize(m_size);
+    std::copy(a, a + m_size, &result.m_data[0]);
+    result.remove_empty_registers();
+    return result;
+  }
+
+  bool is_reduced(const BigInt &x) const {
+    return !x.neg && x.lt_abs(m_modulus);
+  }
+
+  public:
+  explicit BarrettContext(const BigInt &modulus) : m_modulus(modulus, false) {
+    m_size = m_modulus.m_data.size();
+    assert(m_size);
+    BigInt power(1ULL);
+    power <<= 2 * m_size * BigInt::internal_bitlen;
+    m_mu = power / m_modulus;
+  }
+
+  const BigInt& modulus() const {
+    return m_modulus;
+  }
+
+  /**
+   * x mod n in [0, n), for any x.
+   */
+  BigInt reduce(const BigInt &x) const {
+    BigInt r;
+    if (x.m_data.size() <= 2*m_size) {
+      ScratchFrame frame;
+      internal_type *a = frame.alloc<internal_type>(m_size);
+      reduce_limbs(a, x.m_data.size() ? &x.m_data[0] : a, x.m_data.size());
+      r = store(a);
+    } else {
+      r = BigInt(x, false) % m_modulus;
+    }
+    if (x.neg && !r.is_zero())
+      r = m_modulus - r;
+    return r;
+  }
+
+  /**
+   * a*b mod n. Reduced operands are multiplied and reduced in scratch memory directly.
+   */
+  BigInt mulmod(const BigInt &a, const BigInt &b) const {
+    if (!is_reduced(a) || !is_reduced(b))
+      return mulmod(reduce(a), reduce(b));
+    const size_t na = a.m_data.size(), nb = b.m_data.size();
+    if (!na || !nb)
+      return BigInt();
+    ScratchFrame frame;
+    internal_type *p = frame.alloc<internal_type>(na + nb + m_size);
+    internal_type *r = p + na + nb;
+    BigInt::limbs_mul(p, &a.m_data[0], na, &b.m_data[0], nb);
+    reduce_limbs(r, p, na + nb);
+    return store(r);
+  }
+
+  /**
+   * a+b mod n, for reduced operands this is a single conditional subtraction.
+   */
+  BigInt addmod(const BigInt &a, const BigInt &b) const {
+    if (!is_reduced(a) || !is_reduced(b))
+      return addmod(reduce(a), reduce(b));
+    BigInt sum(a + b);
+    if (!sum.lt_abs(m_modulus))
+      sum -= m_modulus;
+    return sum;
+  }
+};
+
+/**
+ * base^exp mod |mod|, in [0, |mod|). The exponent is used by its absolute value, a zero
+ * modulus gives 0 (same as for operator%).
+ *
+ * Odd moduli go through a MontgomeryContext, even ones through a BarrettContext.
+ */
+inline BigInt powmod(const BigInt &base, const BigInt &exp, const BigInt &mod) {
+  const BigInt m(mod, false);
+  if (m.mod_limb(2) == 1 && m != BigInt(1ULL))
+    return MontgomeryContext(m).pow(base, exp);
+  if (m.lt_abs(2))
+    return BigInt();
+
+  const BarrettContext ctx(m);
+  const BigInt b(ctx.reduce(base));
+  BigInt result(1ULL);
+  for (uint64_t i = exp.get_highest_set_bit_position(); i-- > 0;) {
+    result = ctx.mulmod(result, result);
+    if (exp.get_bits_at_pos(i, 1))
+      result = ctx.mulmod(result, b);
+  }
+  return result;
+}
+
+/**
+ * greatest common divisor of |a| and |b|, gcd(x, 0) is |x|.
+ */
+inline BigInt gcd(const BigInt &a, const BigInt &b) {
+  BigInt x(a, false), y(b, false);
+  BigInt::gcd_reduce(x, y, 0, nullptr, 0);
+  return x;
+}
+
+/**
+ * least common multiple of |a| and |b|, 0 if one of them is 0.
+ */
+inline BigInt lcm(const BigInt &a, const BigInt &b) {
+  if (a.is_zero() || b.is_zero())
+    return BigInt();
+  return BigInt(a, false) / gcd(a, b) * BigInt(b, false);
+}
+
+/**
+ * returns g = gcd(a, b) and writes s and t with a*s + b*t = g. If b isn't zero,
+ * |s| <= |b|/(2g), the smallest s there is.
+ */
+inline BigInt extended_gcd(const BigInt &a, const BigInt &b, BigInt &s, BigInt &t) {
+  const BigInt abs_a(a, false), abs_b(b, false);
+  BigInt g(abs_a), y(abs_b);
+  // the cofactors of |a| in g and y
+  BigInt rows[2] = {BigInt(1ULL), BigInt()};
+  BigInt::gcd_reduce(g, y, 0, rows, 1);
+
+  BigInt cofactor = std::move(rows[0]);
+  if (!b.is_zero() && !g.is_zero()) {
+    // any multiple of |b|/g can be added, pick the one closest to zero
+    const BigInt period = abs_b / g;
+    cofactor %= period;
+    if (cofactor.is_neg())
+      cofactor += period;
+    if (period < cofactor + cofactor)
+      cofactor -= period;
+  }
+  t = b.is_zero() ? BigInt() : (g - cofactor * abs_a) / abs_b;
+  s = a.is_neg() ? BigInt() - cofactor : cofactor;
+  if (b.is_neg())
+    t = BigInt() - t;
+  return g;
+}
+
+/**
+ * the inverse of a modulo |mod|, in [0, |mod|). Returns 0 if there is none (a and mod are
+ * not coprime) and for a zero modulus (same as for operator%).
+ */
+inline BigInt modinv(const BigInt &a, const BigInt &mod) {
+  const BigInt m(mod, false);
+  BigInt x = a % m;
+  if (x.is_neg())
+    x += m;
+  BigInt s, t;
+  if (extended_gcd(x, m, s, t) != BigInt(1ULL))
+    return BigInt();
+  if (s.is_neg())
+    s += m;
+  return s;
+}
+
+/**
+ * floor(sqrt(x)), rem is set to x - root^2. Negative x have no square root, they throw
+ * std::domain_error.
+ *
+ * Newton's iteration with increasing precision: the root of the top half of the bits is
+ * taken first (recursively). Shifted back up it's below the root by less than 2^h, for the
+ * h bits that were cut off, and a single Newton step from there lands on the root or one
+ * above it. So it costs about a division and a squaring of the full size, the levels below
+ * add half of that each.
+ */
+inline BigInt isqrt_rem(const BigInt &x, BigInt &rem) {
+  if (x.is_neg() && !x.is_zero())
+    throw std::domain_error("isqrt of a negative number");
+  const BigInt n(x, false);
+  const uint64_t bits = n.get_highest_set_bit_position();
+  BigInt root;
+  if (bits <= 64) {
+    // Newton from above on the limb, it only goes down until it hits the root
+    const uint64_t v = n.get_bits_at_pos(0, 64);
+    uint64_t r = uint64_t(1) << ((bits + 1) / 2);
+    for (uint64_t next = (r + v / r) / 2; v && next < r; next = (r + v / r) / 2)
+      r = next;
+    root = BigInt(v ? r : 0);
+  } else {
+    // the root of the top part keeps more than h+1 bits, that's precise enough
+    const uint64_t h = (bits - 3) / 4;
+    BigInt unused;
+    const BigInt top = isqrt_rem(n >> (2*h), unused) << h;
+    root = (top + n / top) >> 1;
+  }
+  rem = n - root.square();
+  while (rem.is_neg()) {
+    root -= BigInt(1ULL);
+    rem += root + root + BigInt(1ULL);
+  }
+  return root;
+}
+
+/**
+ * floor(sqrt(x)), see isqrt_rem.
+ */
+inline BigInt isqrt(const BigInt &x) {
+  BigInt unused;
+  return isqrt_rem(x, unused);
+}
+
+/**
+ * the k-th root of x, rounded towards zero. Odd roots keep the sign, even roots of negative
+ * x don't exist and throw std::domain_error. k = 0 is taken as 1.
+ *
+ * Same scheme as isqrt_rem: the root of the top bits, shifted up, is the start for one
+ * Newton step x -> ((k-1)*x + n/x^(k-1)) / k. That never ends up below the root, a
+ * comparison with the k-th power takes it down to the root if it's above. Roots that fit
+ * into a limb get their start from a double instead, large k make that the common case.
+ */
+inline BigInt iroot(const BigInt &x, uint64_t k) {
+  if (k <= 1)
+    return x;
+  if (!(k & 1) && x.is_neg() && !x.is_zero())
+    throw std::domain_error("even root of a negative number");
+  if (k == 2)
+    return isqrt(x);
+  const BigInt n(x, false);
+  const uint64_t bits = n.get_highest_set_bit_position();
+  // n < 2^bits <= 2^k leaves 0 and 1
+  if (bits <= k)
+    return n.is_zero() ? BigInt() : BigInt(1ULL, x.is_neg());
+
+  const uint64_t k_bits = 64 - BigInt::count_leading_zeros(k);
+  BigInt root;
+  if ((bits + k - 1) / k <= 64) {
+    // the root fits into a limb. log2(n) from the leading 64 bits gets it right to about
+    // 46 bits, so below 2^40 it's the root or one off, above that the step does the rest.
+    const uint64_t lead = bits > 64 ? bits - 64 : 0;
+    const double log2n = double(lead) + std::log2(double(n.get_bits_at_pos(lead, 64)));
+    // the largest double below 2^64
+    const double estimate = std::min(std::exp2(log2n / double(k)), 18446744073709549568.0);
+    root = BigInt(uint64_t(estimate));
+    if (estimate < double(uint64_t(1) << 40)) {
+      while (n.lt_abs(pow(root, k)))
+        root -= BigInt(1ULL);
+      while (!n.lt_abs(pow(root + BigInt(1ULL), k)))
+        root += BigInt(1ULL);
+      return x.is_neg() ? BigInt() - root : root;
+    }
+  } else {
+    // the root of the top part has k_bits+1 bits more than were cut off, then the step
+    // is off by less than one
+    const uint64_t h = (bits / k - k_bits - 3) / 2;
+    root = iroot(n >> (k*h), k) << h;
+  }
+  root = (root * BigInt(k - 1) + n / pow(root, k - 1)) / BigInt(k);
+  while (n.lt_abs(pow(root, k)))
+    root -= BigInt(1ULL);
+  return x.is_neg() ? BigInt() - root : root;
+}
+
+/**
+ * whether x is the square of an integer (0 and 1 are).
+ */
+inline bool is_perfect_square(const BigInt &x) {
+  if (x.is_neg() && !x.is_zero())
+    return false;
+  if (!BigInt::square_residue_filter(x))
+    return false;
+  BigInt rem;
+  isqrt_rem(x, rem);
+  return rem.is_zero();
+}
+
+/**
+ * whether x = root^k for some integer root and k >= 2, k is made as large as possible then.
+ * Negative x can only be odd powers. 0 and 1 are reported as squares of themselves, -1 as
+ * (-1)^3.
+ *
+ * Only prime exponents p need to be tried, root^p is taken apart further afterwards. Most p
+ * are ruled out without a root: the number of trailing zero bits has to be a multiple of p.
+ * A root below 2^32 would be the nearest integer to 2^(log2(|x|)/p), p times its logarithm
+ * has to match log2(|x|) from the leading bits then, that costs nothing for most p. For the
+ * few small p left, residues modulo a few small primes have to be p-th powers.
+ */
+inline bool is_perfect_power(const BigInt &x, BigInt &root, uint64_t &k) {
+  const BigInt n(x, false);
+  const uint64_t bits = n.get_highest_set_bit_position();
+  if (bits <= 1) {
+    root = x;
+    k = x.is_neg() ? 3 : 2;
+    return true;
+  }
+  uint64_t twos = 0;
+  while (!n.get_bits_at_pos(twos, 64))
+    twos += 64;
+  twos += BigInt::count_trailing_zeros(n.get_bits_at_pos(twos, 64));
+  const uint64_t lead = bits > 64 ? bits - 64 : 0;
+  const double log2n = double(lead) + std::log2(double(n.get_bits_at_pos(lead, 64)));
+  // n >= 2^(bits-1) and root >= 2, so p < bits
+  for (uint64_t p = 2; p < bits; ++p) {
+    if (!BigInt::is_prime_limb(p) || (twos && twos % p) || (p == 2 && x.is_neg()))
+      continue;
+    if ((bits + p - 1) / p <= 32) {
+      // both logarithms are off by a few units in the last place of log2n at most, the
+      // powers of the integers around r are much further apart
+      const double r = std::floor(std::exp2(log2n / double(p)) + 0.5);
+      if (std::fabs(double(p) * std::log2(r) - log2n) > log2n * 1e-14)
+        continue;
+    } else if (p == 2 ? !BigInt::square_residue_filter(n) : !BigInt::power_residue_filter(n, p)) {
+      continue;
+    }
+    BigInt r = iroot(x, p);
+    if (pow(r, p) != x)
+      continue;
+    uint64_t k2;
+    if (is_perfect_power(r, root, k2)) {
+      k = p * k2;
+    } else {
+      root = std::move(r);
+      k = p;
+    }
+    return true;
+  }
+  return false;
+}
+
+/**
+ * whether x = root^k for some integer root and k >= 2, see above.
+ */
+inline bool is_perfect_power(const BigInt &x) {
+  BigInt root;
+  uint64_t k;
+  return is_perfect_power(x, root, k);
+}
+
+/**
+ * A batch of unsigned numbers that all have the same number of limbs, stored as a structure
+ * of arrays: limb i of all numbers is contiguous, limb(i)[j] is limb i of number j. So the
+ * batch operations can work on several numbers at once with SIMD instructions. AVX-512 or
+ * AVX2 is used if the CPU has it (checked at runtime), plain loops otherwise.
+ *
+ * Results are truncated to the limbs of the destination, as with fixed size unsigned
+ * integers: a sum needs one limb more than the operands and a product twice as many to be
+ * exact, and a negative difference wraps around. Destinations may be one of the operands.
+ */
+class BigIntBatch {
+  public:
+  typedef BigInt::internal_type internal_type;
+  // each level includes the ones before it
+  enum simd_level { simd_scalar, simd_avx2, simd_avx512, simd_avx512_ifma };
+  // the numbers in a row are padded to a multiple of this, the widest vector.
+  static const size_t lanes = 8;
+
+  private:
+  size_t m_limbs;
+  size_t m_count;
+  // distance between two limb rows. The padding numbers are zero and take part in the
+  // arithmetic like any other, so the kernels only ever see whole vectors.
+  size_t m_stride;
+  std::vector<internal_type> m_data;
+
+  /**
+   * count rounded up to whole vectors. Rows that are a multiple of 4k apart would all
+   * land in the same cache sets, those get one more vector.
+   */
+  static size_t padded_stride(size_t count) {
+    size_t stride = (count + lanes - 1) / lanes * lanes;
+    if (stride % (4096 / sizeof(internal_type)) == 0)
+      stride += lanes;
+    return stride;
+  }
+
+  static simd_level& simd_setting() {
+    static simd_level level = detect_simd();
+    return level;
+  }
+
+  public:
+  BigIntBatch(size_t limbs, size_t count) : m_limbs(limbs), m_count(count),
+      m_stride(padded_stride(count)), m_data(limbs * m_stride) {
+    assert(limbs > 0);
+  }
+
+  size_t limbs() const {
+    return m_limbs;
+  }
+
+  size_t size() const {
+    return m_count;
+  }
+
+  size_t stride() const {
+    return m_stride;
+  }
+
+  /**
+   * limb i of all numbers, limb(i)[j] belongs to number j.
+   */
+  internal_type* limb(size_t i) {
+    return m_data.data() + i*m_stride;
+  }
+
+  const internal_type* limb(size_t i) const {
+    return m_data.data() + i*m_stride;
+  }
+
+  /**
+   * stores the absolute value of x as number j, truncated to limbs() limbs.
+   */
+  void set(size_t j, const BigInt &x) {
+    assert(j < m_count);
+    const size_t n = std::min(m_limbs, x.m_data.size());
+    for (size_t i = 0; i < m_limbs; ++i)
+      m_data[i*m_stride + j] = i < n ? x.m_data[i] : BigInt::internal_0;
+  }
+
+  BigInt get(size_t j) const {
+    assert(j < m_count);
+    BigInt result;
+    result.m_data.resize(m_limbs);
+    for (size_t i = 0; i < m_limbs; ++i)
+      result.m_data[i] = m_data[i*m_stride + j];
+    result.remove_empty_registers();
+    return result;
+  }
+
+  /**
+   * the best instruction set the CPU supports.
+   */
+  static simd_level detect_simd() {
+#ifdef BIGINT_X86
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma"))
+      return simd_avx512_ifma;
+    if (__builtin_cpu_supports("avx512f"))
+      return simd_avx512;
+    if (__builtin_cpu_supports("avx2"))
+      return simd_avx2;
+#endif
+    return simd_scalar;
+  }
+
+  static simd_level simd() {
+    return simd_setting();
+  }
+
+  /**
+   * limits the batch operations to the given instruction set, for testing and benchmarks.
+   * Levels the CPU doesn't support are ignored. Must not be called while batch operations
+   * are running in other threads.
+   */
+  static void set_simd(simd_level level) {
+    simd_setting() = std::min(level, detect_simd());
+  }
+
+  private:
+  /*
+   * The kernels work on rows of stride limbs: r = a op b for n-limb a and b and an rn-limb
+   * r, over all stride numbers. Limbs of r beyond the result are filled with zeros (or the
+   * sign extension of a difference).
+   */
+
+  static void add_scalar(internal_type *r, size_t rn, const internal_type *a, const internal_type *b,
+                         size_t n, size_t stride) {
+    const size_t m = std::min(n, rn);
+    for (size_t j = 0; j < stride; ++j) {
+      internal_type carry = 0;
+      for (size_t i = 0; i < m; ++i)
+        carry = BigInt::add_carry(a[i*stride + j], b[i*stride + j], carry, r[i*stride + j]);
+      for (size_t i = m; i < rn; ++i, carry = 0)
+        r[i*stride + j] = carry;
+    }
+  }
+
+  static void sub_scalar(internal_type *r, size_t rn, const internal_type *a, const internal_type *b,
+                         size_t n, size_t stride) {
+    const size_t m = std::min(n, rn);
+    for (size_t j = 0; j < stride; ++j) {
+      internal_type borrow = 0;
+      for (size_t i = 0; i < m; ++i)
+        borrow = BigInt::sub_borrow(a[i*stride + j], b[i*stride + j], borrow, r[i*stride + j]);
+      for (size_t i = m; i < rn; ++i)
+        r[i*stride + j] = 0 - borrow;
+    }
+  }
+
+  static void mul_scalar(internal_type *r, size_t rn, const internal_type *a, const internal_type *b,
+                         size_t n, size_t stride) {
+    ScratchFrame frame;
+    // a block of lanes is copied into n-limb numbers (and back) in one go
+    internal_type *ta = frame.alloc<internal_type>(4*n*lanes);
+    // a square is recognized by limbs_mul when both operands are the same limbs
+    internal_type *tb = a == b ? ta : ta + n*lanes, *tr = ta + 2*n*lanes;
+    for (size_t j = 0; j < stride; j += lanes) {
+      for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < lanes; ++k) {
+          ta[k*n + i] = a[i*stride + j + k];
+          tb[k*n + i] = b[i*stride + j + k];
+        }
+      }
+      for (size_t k = 0; k < lanes; ++k)
+        BigInt::limbs_mul(tr + 2*n*k, ta + n*k, n, tb + n*k, n);
+      for (size_t i = 0; i < rn; ++i) {
+        for (size_t k = 0; k < lanes; ++k)
+          r[i*stride + j + k] = i < 2*n ? tr[2*n*k + i] : BigInt::internal_0;
+      }
+    }
+  }
+
+  /**
+   * result[j] = -1, 0 or 1 for a[j] <, == or > b[j], for the first count numbers.
+   */
+  static void compare_scalar(int *result, const internal_type *a, const internal_type *b,
+                             size_t n, size_t stride, size_t count) {
+    for (size_t j = 0; j < count; ++j) {
+      result[j] = 0;
+      for (size_t i = n; i-- > 0;) {
+        const internal_type x = a[i*stride + j], y = b[i*stride + j];
+        if (x != y) {
+          result[j] = x < y ? -1 : 1;
+          break;
+        }
+      }
+    }
+  }
+
+#ifdef BIGINT_X86
+  /**
+   * unsigned a < b, there only is a signed 64 bit comparison before AVX-512.
+   */
+  BIGINT_TARGET("avx2")
+  static __m256i less_avx2(__m256i a, __m256i b) {
+    const __m256i sign = _mm256_set1_epi64x((long long)1 << 63);
+    return _mm256_cmpgt_epi64(_mm256_xor_si256(b, sign), _mm256_xor_si256(a, sign));
+  }
+
+  BIGINT_TARGET("avx2")
+  static void add_avx2(internal_type *r, size_t rn, const internal_type *a, const internal_type *b,
+                       size_t n, size_t stride) {
+    const size_t m = std::min(n, rn);
+    const __m256i one = _mm256_set1_epi64x(1);
+    for (size_t j = 0; j < stride; j += 4) {
+      __m256i carry = _mm256_setzero_si256();
+      for (size_t i = 0; i < m; ++i) {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(a + i*stride + j));
+        const __m256i y = _mm256_loadu_si256((const __m256i*)(b + i*stride + j));
+        const __m256i s = _mm256_add_epi64(x, y), t = _mm256_add_epi64(s, carry);
+        carry = _mm256_and_si256(_mm256_or_si256(less_avx2(s, x), less_avx2(t, s)), one);
+        _mm256_storeu_si256((__m256i*)(r + i*stride + j), t);
+      }
+      for (size_t i = m; i < rn; ++i, carry = _mm256_setzero_si256())
+        _mm256_storeu_si256((__m256i*)(r + i*stride + j), carry);
+    }
+  }
+
+  BIGINT_TARGET("avx2")
+  static void sub_avx2(internal_type *r, size_t rn, const internal_type *a, const internal_type *b,
+                       size_t n, size_t stride) {
+    const size_t m = std::min(n, rn);
+    const __m256i one = _mm256_set1_epi64x(1);
+    for (size_t j = 0; j < stride; j += 4) {
+      __m256i borrow = _mm256_setzero_si256();
+      for (size_t i = 0; i < m; ++i) {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(a + i*stride + j));
+        const __m256i y = _mm256_loadu_si256((const __m256i*)(b + i*stride + j));
+        const __m256i d = _mm256_sub_epi64(x, y), t = _mm256_sub_epi64(d, borrow);
+        borrow = _mm256_and_si256(_mm256_or_si256(less_avx2(x, y), less_avx2(d, borrow)), one);
+        _mm256_storeu_si256((__m256i*)(r + i*stride + j), t);
+      }
+      const __m256i extension = _mm256_sub_epi64(_mm256_setzero_si256(), borrow);
+      for (size_t i = m; i < rn; ++i)
+        _mm256_storeu_si256((__m256i*)(r + i*stride + j), extension);
+    }
+  }
+
+  BIGINT_TARGET("avx2")
+  static void compare_avx2(int *result, const internal_type *a, const internal_type *b,
+                           size_t n, size_t stride, size_t count) {
+    for (size_t j = 0; j < count; j += 4) {
+      // lanes that are greater, less, and still undecided
+      int greater = 0, less = 0, open = 0xf;
+      for (size_t i = n; i-- > 0 && open;) {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(a + i*stride + j));
+        const __m256i y = _mm256_loadu_si256((const __m256i*)(b + i*stride + j));
+        const int gt = _mm256_movemask_pd(_mm256_castsi256_pd(less_avx2(y, x)));
+        const int lt = _mm256_movemask_pd(_mm256_castsi256_pd(less_avx2(x, y)));
+        greater |= gt & open;
+        less |= lt & open;
+        open &= ~(gt | lt);
+      }
+      for (size_t k = 0; k < 4 && j + k < count; ++k)
+        result[j + k] = ((greater >> k) & 1) - ((less >> k) & 1);
+    }
+  }
+
+  /*
+   * the AVX-512 shifts and multiplications are the zero masked forms with all lanes set,
+   * gcc warns about the undefined pass-through operand of the plain ones.
+   */
+  BIGINT_TARGET("avx512f")
+  static void add_avx512(internal_type *r, size_t rn, const internal_type *a, const internal_type *b,
+                         size_t n, size_t stride) {
+    const size_t m = std::min(n, rn);
+    const __m512i zero = _mm512_setzero_si512(), one = _mm512_set1_epi64(1);
+    for (size_t j = 0; j < stride; j += 8) {
+      __mmask8 carry = 0;
+      for (size_t i = 0; i < m; ++i) {
+        const __m512i x = _mm512_loadu_si512(a + i*stride + j), y = _mm512_loadu_si512(b + i*stride + j);
+        const __m512i s = _mm512_add_epi64(x, y), t = _mm512_mask_add_epi64(s, carry, s, one);
+        carry = _mm512_cmplt_epu64_mask(s, x) | _mm512_mask_cmpeq_epi64_mask(carry, t, zero);
+        _mm512_storeu_si512(r + i*stride + j, t);
+      }
+      for (size_t i = m; i < rn; ++i, carry = 0)
+        _mm512_storeu_si512(r + i*stride + j, _mm512_maskz_mov_epi64(carry, one));
+    }
+  }
+
+  BIGINT_TARGET("avx512f")
+  static void sub_avx512(internal_type *r, size_t rn, const internal_type *a, const internal_type *b,
+                         size_t n, size_t stride) {
+    const size_t m = std::min(n, rn);
+    const __m512i zero = _mm512_setzero_si512(), one = _mm512_set1_epi64(1);
+    for (size_t j = 0; j < stride; j += 8) {
+      __mmask8 borrow = 0;
+      for (size_t i = 0; i < m; ++i) {
+        const __m512i x = _mm512_loadu_si512(a + i*stride + j), y = _mm512_loadu_si512(b + i*stride + j);
+        const __m512i d = _mm512_sub_epi64(x, y), t = _mm512_mask_sub_epi64(d, borrow, d, one);
+        borrow = _mm512_cmplt_epu64_mask(x, y) | _mm512_mask_cmpeq_epi64_mask(borrow, d, zero);
+        _mm512_storeu_si512(r + i*stride + j, t);
+      }
+      const __m512i extension = _mm512_maskz_mov_epi64(borrow, _mm512_set1_epi64(-1));
+      for (size_t i = m; i < rn; ++i)
+        _mm512_storeu_si512(r + i*stride + j, extension);
+    }
+  }
+
+  BIGINT_TARGET("avx512f")
+  static void compare_avx512(int *result, const internal_type *a, const internal_type *b,
+                             size_t n, size_t stride, size_t count) {
+    for (size_t j = 0; j < count; j += 8) {
+      __mmask8 greater = 0, less = 0, open = 0xff;
+      for (size_t i = n; i-- > 0 && open;) {
+        const __m512i x = _mm512_loadu_si512(a + i*stride + j), y = _mm512_loadu_si512(b + i*stride + j);
+        const __mmask8 gt = _mm512_mask_cmpgt_epu64_mask(open, x, y);
+        const __mmask8 lt = _mm512_mask_cmplt_epu64_mask(open, x, y);
+        greater |= gt;
+        less |= lt;
+        open &= ~(gt | lt);
+      }
+      for (size_t k = 0; k < 8 && j + k < count; ++k)
+        result[j + k] = ((greater >> k) & 1) - ((less >> k) & 1);
+    }
+  }
+
+  /**
+   * digit size in bits for the AVX-512F products of n-limb numbers. There are no 64x64
+   * bit vector multiplications, so the numbers are cut into digits of at most 31 bits and
+   * the 64 bit digit products are summed up per column. All column sums (up to digits
+   * times 2^2bits) have to stay below 2^63, which leaves room for the carries.
+   */
+  static unsigned mul_digit_bits(size_t n, size_t &digits) {
+    for (unsigned bits = 31;; --bits) {
+      digits = (BigInt::internal_bitlen*n + bits - 1) / bits;
+      if (digits <= ((size_t)1 << (63 - 2*bits)))
+        return bits;
+    }
+  }
+
+  /**
+   * d[8k..8k+8) = digit k of the 8 numbers at a, digits of the given bits.
+   */
+  BIGINT_TARGET("avx512f")
+  static void digits_avx512(internal_type *d, const internal_type *a, size_t n, size_t stride,
+                            unsigned bits, size_t digits) {
+    const __m512i mask = _mm512_set1_epi64(((long long)1 << bits) - 1);
+    for (size_t k = 0; k < digits; ++k) {
+      const size_t w = k*bits / 64;
+      const int sh = k*bits % 64;
+      __m512i x = _mm512_maskz_srl_epi64(0xff, _mm512_loadu_si512(a + w*stride), _mm_cvtsi32_si128(sh));
+      if (sh + bits > 64 && w + 1 < n)
+        x = _mm512_or_si512(x, _mm512_maskz_sll_epi64(0xff, _mm512_loadu_si512(a + (w+1)*stride),
+                                                      _mm_cvtsi32_si128(64 - sh)));
+      _mm512_storeu_si512(d + 8*k, _mm512_and_si512(x, mask));
+    }
+  }
+
+  /**
+   * ors digit k of bits bits into its place in the np limbs at prod.
+   */
+  BIGINT_TARGET("avx512f")
+  static void put_digit_avx512(internal_type *prod, size_t np, __m512i digit, size_t k, unsigned bits) {
+    const size_t w = k*bits / 64;
+    const int sh = k*bits % 64;
+    if (w >= np)
+      return;
+    internal_type *p = prod + 8*w;
+    _mm512_storeu_si512(p, _mm512_or_si512(_mm512_loadu_si512(p),
+                                           _mm512_maskz_sll_epi64(0xff, digit, _mm_cvtsi32_si128(sh))));
+    if (sh + bits > 64 && w + 1 < np)
+      _mm512_storeu_si512(p + 8, _mm512_or_si512(_mm512_loadu_si512(p + 8),
+                                                 _mm512_maskz_srl_epi64(0xff, digit, _mm_cvtsi32_si128(64 - sh))));
+  }
+
+  /**
+   * product scanning over the digits of mul_digit_bits: every column is summed up in a
+   * register, then the carry of the previous column is added and the low bits are put into
+   * place in the 2n limbs of the product.
+   */
+  BIGINT_TARGET("avx512f")
+  static void mul_avx512(internal_type *r, size_t rn, const internal_type *a, const internal_type *b,
+                         size_t n, size_t stride) {
+    size_t digits;
+    const unsigned bits = mul_digit_bits(n, digits);
+    const __m512i mask = _mm512_set1_epi64(((long long)1 << bits) - 1);
+    ScratchFrame frame;
+    internal_type *da = frame.alloc<internal_type>(8*(2*digits + 2*n));
+    internal_type *db = a == b ? da : da + 8*digits, *prod = da + 16*digits;
+    for (size_t j = 0; j < stride; j += 8) {
+      digits_avx512(da, a + j, n, stride, bits, digits);
+      if (db != da)
+        digits_avx512(db, b + j, n, stride, bits, digits);
+      std::fill(prod, prod + 8*2*n, internal_type(BigInt::internal_0));
+      __m512i carry = _mm512_setzero_si512();
+      for (size_t k = 0; k < 2*digits; ++k) {
+        __m512i sum = carry;
+        for (size_t i = k >= digits ? k - digits + 1 : 0; i <= k && i < digits; ++i)
+          sum = _mm512_add_epi64(sum, _mm512_maskz_mul_epu32(0xff, _mm512_loadu_si512(da + 8*i),
+                                                             _mm512_loadu_si512(db + 8*(k-i))));
+        put_digit_avx512(prod, 2*n, _mm512_and_si512(sum, mask), k, bits);
+        carry = _mm512_maskz_srl_epi64(0xff, sum, _mm_cvtsi32_si128(bits));
+      }
+      for (size_t i = 0; i < rn; ++i)
+        _mm512_storeu_si512(r + i*stride + j, i < 2*n ? _mm512_loadu_si512(prod + 8*i) : _mm512_setzero_si512());
+    }
+  }
+
+  // operand size up to which the column sums of mul_avx512_ifma can't overflow.
+  static const size_t ifma_max_limbs = 512;
+
+  /**
+   * the same with 52 bit digits and the IFMA multiply-adds, which add the low or the high
+   * 52 bits of a 52x52 bit product to a lane. The low halves go into column k and the high
+   * halves into column k+1, so there are far fewer digit products than with 32x32 bits.
+   */
+  BIGINT_TARGET("avx512f,avx512ifma")
+  static void mul_avx512_ifma(internal_type *r, size_t rn, const internal_type *a, const internal_type *b,
+                              size_t n, size_t stride) {
+    const unsigned bits = 52;
+    const size_t digits = (BigInt::internal_bitlen*n + bits - 1) / bits;
+    assert(n <= ifma_max_limbs);
+    const __m512i mask = _mm512_set1_epi64(((long long)1 << bits) - 1);
+    ScratchFrame frame;
+    internal_type *da = frame.alloc<internal_type>(8*(2*digits + 2*n));
+    internal_type *db = a == b ? da : da + 8*digits, *prod = da + 16*digits;
+    for (size_t j = 0; j < stride; j += 8) {
+      digits_avx512(da, a + j, n, stride, bits, digits);
+      if (db != da)
+        digits_avx512(db, b + j, n, stride, bits, digits);
+      std::fill(prod, prod + 8*2*n, internal_type(BigInt::internal_0));
+      __m512i carry = _mm512_setzero_si512();
+      for (size_t k = 0; k < 2*digits; ++k) {
+        // two sums each for the low and high halves, a single one would wait for the latency
+        // of every multiply-add.
+        __m512i lo0 = carry, lo1 = _mm512_setzero_si512(), hi0 = _mm512_setzero_si512(), hi1 = hi0;
+        size_t i = k >= digits ? k - digits + 1 : 0;
+        const size_t end = std::min(k + 1, digits);
+        for (; i + 1 < end; i += 2) {
+          lo0 = _mm512_madd52lo_epu64(lo0, _mm512_loadu_si512(da + 8*i), _mm512_loadu_si512(db + 8*(k-i)));
+          lo1 = _mm512_madd52lo_epu64(lo1, _mm512_loadu_si512(da + 8*(i+1)),
+                                      _mm512_loadu_si512(db + 8*(k-i-1)));
+        }
+        if (i < end)
+          lo0 = _mm512_madd52lo_epu64(lo0, _mm512_loadu_si512(da + 8*i), _mm512_loadu_si512(db + 8*(k-i)));
+        i = k > digits ? k - digits : 0;
+        const size_t hi_end = std::min(k, digits);
+        for (; i + 1 < hi_end; i += 2) {
+          hi0 = _mm512_madd52hi_epu64(hi0, _mm512_loadu_si512(da + 8*i),
+                                      _mm512_loadu_si512(db + 8*(k-1-i)));
+          hi1 = _mm512_madd52hi_epu64(hi1, _mm512_loadu_si512(da + 8*(i+1)),
+                                      _mm512_loadu_si512(db + 8*(k-2-i)));
+        }
+        if (i < hi_end)
+          hi0 = _mm512_madd52hi_epu64(hi0, _mm512_loadu_si512(da + 8*i), _mm512_loadu_si512(db + 8*(k-1-i)));
+        const __m512i sum = _mm512_add_epi64(_mm512_add_epi64(lo0, lo1), _mm512_add_epi64(hi0, hi1));
+        put_digit_avx512(prod, 2*n, _mm512_and_si512(sum, mask), k, bits);
+        carry = _mm512_maskz_srl_epi64(0xff, sum, _mm_cvtsi32_si128(bits));
+      }
+      for (size_t i = 0; i < rn; ++i)
+        _mm512_storeu_si512(r + i*stride + j, i < 2*n ? _mm512_loadu_si512(prod + 8*i) : _mm512_setzero_si512());
+    }
+  }
+#endif
+
+  public:
+  /**
+   * r = a + b for all numbers. a and b must have the same number of limbs and numbers, r
+   * the same number of numbers.
+   */
+  static void add(BigIntBatch &r, const BigIntBatch &a, const BigIntBatch &b) {
+    assert(a.m_limbs == b.m_limbs && a.m_count == b.m_count && r.m_count == a.m_count);
+    internal_type *rp = r.m_data.data();
+    const internal_type *ap = a.m_data.data(), *bp = b.m_data.data();
+    switch (simd()) {
+#ifdef BIGINT_X86
+      case simd_avx512_ifma:
+      case simd_avx512: add_avx512(rp, r.m_limbs, ap, bp, a.m_limbs, a.m_stride); break;
+      case simd_avx2: add_avx2(rp, r.m_limbs, ap, bp, a.m_limbs, a.m_stride); break;
+#endif
+      default: add_scalar(rp, r.m_limbs, ap, bp, a.m_limbs, a.m_stride);
+    }
+  }
+
+  /**
+   * r = a - b for all numbers, modulo 2^(64*r.limbs()).
+   */
+  static void sub(BigIntBatch &r, const BigIntBatch &a, const BigIntBatch &b) {
+    assert(a.m_limbs == b.m_limbs && a.m_count == b.m_count && r.m_count == a.m_count);
+    internal_type *rp = r.m_data.data();
+    const internal_type *ap = a.m_data.data(), *bp = b.m_data.data();
+    switch (simd()) {
+#ifdef BIGINT_X86
+      case simd_avx512_ifma:
+      case simd_avx512: sub_avx512(rp, r.m_limbs, ap, bp, a.m_limbs, a.m_stride); break;
+      case simd_avx2: sub_avx2(rp, r.m_limbs, ap, bp, a.m_limbs, a.m_stride); break;
+#endif
+      default: sub_scalar(rp, r.m_limbs, ap, bp, a.m_limbs, a.m_stride);
+    }
+  }
+
+  /**
+   * r = a * b for all numbers, exact if r has twice the limbs of a and b.
+   */
+  static void mul(BigIntBatch &r, const BigIntBatch &a, const BigIntBatch &b) {
+    assert(a.m_limbs == b.m_limbs && a.m_count == b.m_count && r.m_count == a.m_count);
+    internal_type *rp = r.m_data.data();
+    const internal_type *ap = a.m_data.data(), *bp = b.m_data.data();
+    switch (simd()) {
+#ifdef BIGINT_X86
+      case simd_avx512_ifma:
+        if (a.m_limbs <= ifma_max_limbs) {
+          mul_avx512_ifma(rp, r.m_limbs, ap, bp, a.m_limbs, a.m_stride);
+          break;
+        }
+        // fall through
+      case simd_avx512: mul_avx512(rp, r.m_limbs, ap, bp, a.m_limbs, a.m_stride); break;
+#endif
+      // AVX2 has no 64 bit multiplication, with 32 bit digits it was slower than mulq.
+      default: mul_scalar(rp, r.m_limbs, ap, bp, a.m_limbs, a.m_stride);
+    }
+  }
+
+  /**
+   * result[j] = -1, 0 or 1 if number j of a is less than, equal to or greater than number j
+   * of b. result must have room for size() values.
+   */
+  static void compare(int *result, const BigIntBatch &a, const BigIntBatch &b) {
+    assert(a.m_limbs == b.m_limbs && a.m_count == b.m_count);
+    const internal_type *ap = a.m_data.data(), *bp = b.m_data.data();
+    switch (simd()) {
+#ifdef BIGINT_X86
+      case simd_avx512_ifma:
+      case simd_avx512: compare_avx512(result, ap, bp, a.m_limbs, a.m_stride, a.m_count); break;
+      case simd_avx2: compare_avx2(result, ap, bp, a.m_limbs, a.m_stride, a.m_count); break;
+#endif
+      default: compare_scalar(result, ap, bp, a.m_limbs, a.m_stride, a.m_count);
+    }
+  }
+};
+
+/**
+ * An unsigned integer of exactly Bits bits (a multiple of 64), with its limbs in the object
+ * itself. Arithmetic wraps around modulo 2^Bits like the built-in unsigned types, and all
+ * loops run over the fixed number of limbs, so there are no allocations and no branches on
+ * the size of the numbers.
+ *
+ * With C++14 everything except the BigInt conversions is constexpr, so constants can be
+ * computed at compile time:
+ *
+ *   constexpr FixedBigInt<256> p = (FixedBigInt<256>(1) << 255) - FixedBigInt<256>(19);
+ */
+template <size_t Bits>
+class FixedBigInt {
+  static_assert(Bits > 0 && Bits % 64 == 0, "FixedBigInt needs a positive multiple of 64 bits");
+  template <size_t> friend class FixedBigInt;
+
+  public:
+  typedef BigInt::internal_type internal_type;
+  static const size_t limbs = Bits / BigInt::internal_bitlen;
+
+  private:
+  // least significant limb first, like BigInt
+  internal_type m_limbs[limbs];
+
+  public:
+  constexpr FixedBigInt() : m_limbs{} {}
+
+  constexpr FixedBigInt(uint64_t x) : m_limbs{x} {}
+
+  /**
+   * the absolute value of x modulo 2^Bits.
+   */
+  explicit FixedBigInt(const BigInt &x) : m_limbs{} {
+    std::copy(x.m_data.begin(), x.m_data.begin() + std::min(x.m_data.size(), limbs), m_limbs);
+  }
+
+  /**
+   * parses hex digits, with or without 0x in front. Digits beyond Bits are cut off at the
+   * top, anything that's not a hex digit is skipped.
+   */
+  static BIGINT_CONSTEXPR14 FixedBigInt from_hex(const char *s) {
+    FixedBigInt result;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+      s += 2;
+    for (; *s; ++s) {
+      const char c = *s;
+      const internal_type digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                                : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+      if (digit < 16) {
+        result <<= 4;
+        result.m_limbs[0] |= digit;
+      }
+    }
+    return result;
+  }
+
+  BigInt to_bigint() const {
+    BigInt result;
+    result.m_data.resize(limbs);
+    std::copy(m_limbs, m_limbs + limbs, &result.m_data[0]);
+    result.remove_empty_registers();
+    return result;
+  }
+
+  std::string toString(uint8_t radix=10, bool uppercase=false) const {
+    return to_bigint().toString(radix, uppercase);
+  }
+
+  constexpr internal_type limb(size_t i) const {
+    return m_limbs[i];
+  }
+
+  BIGINT_CONSTEXPR14 void set_limb(size_t i, internal_type value) {
+    m_limbs[i] = value;
+  }
+
+  BIGINT_CONSTEXPR14 bool is_zero() const {
+    internal_type any = 0;
+    BIGINT_UNROLL
+    for (size_t i = 0; i < limbs; ++i)
+      any |= m_limbs[i];
+    return !any;
+  }
+
+  /**
+   * -1, 0 or 1 for a <, == or > b.
+   */
+  static BIGINT_CONSTEXPR14 int compare(const FixedBigInt &a, const FixedBigInt &b) {
+    BIGINT_UNROLL
+    for (size_t k = 1; k <= limbs; ++k) {
+      const size_t i = limbs - k;
+      if (a.m_limbs[i] != b.m_limbs[i])
+        return a.m_limbs[i] < b.m_limbs[i] ? -1 : 1;
+    }
+    return 0;
+  }
+
+  /**
+   * r = a + b, returns the carry. r may be a or b.
+   */
+  static BIGINT_CONSTEXPR14 internal_type add(FixedBigInt &r, const FixedBigInt &a, const FixedBigInt &b) {
+    internal_type carry = 0;
+    BIGINT_UNROLL
+    for (size_t i = 0; i < limbs; ++i) {
+      const internal_type s = a.m_limbs[i] + carry;
+      carry = s < carry;
+      r.m_limbs[i] = s + b.m_limbs[i];
+      carry += r.m_limbs[i] < s;
+    }
+    return carry;
+  }
+
+  /**
+   * r = a - b, returns the borrow. r may be a or b.
+   */
+  static BIGINT_CONSTEXPR14 internal_type sub(FixedBigInt &r, const FixedBigInt &a, const FixedBigInt &b) {
+    internal_type borrow = 0;
+    BIGINT_UNROLL
+    for (size_t i = 0; i < limbs; ++i) {
+      const internal_type d = a.m_limbs[i] - b.m_limbs[i];
+      const internal_type borrow_out = (a.m_limbs[i] < b.m_limbs[i]) | (d < borrow);
+      r.m_limbs[i] = d - borrow;
+      borrow = borrow_out;
+    }
+    return borrow;
+  }
+
+  BIGINT_CONSTEXPR14 FixedBigInt& operator+=(const FixedBigInt &b) {
+    add(*this, *this, b);
+    return *this;
+  }
+
+  BIGINT_CONSTEXPR14 FixedBigInt& operator-=(const FixedBigInt &b) {
+    sub(*this, *this, b);
+    return *this;
+  }
+
+  BIGINT_CONSTEXPR14 FixedBigInt& operator*=(const FixedBigInt &b) {
+    return *this = *this * b;
+  }
+
+  BIGINT_CONSTEXPR14 FixedBigInt& operator<<=(size_t bits) {
+    const size_t shift = bits / BigInt::internal_bitlen, sh = bits % BigInt::internal_bitlen;
+    BIGINT_UNROLL
+    for (size_t k = 1; k <= limbs; ++k) {
+      const size_t i = limbs - k;
+      internal_type v = 0;
+      if (i >= shift) {
+        v = m_limbs[i - shift] << sh;
+        if (sh && i > shift)
+          v |= m_limbs[i - shift - 1] >> (BigInt::internal_bitlen - sh);
+      }
+      m_limbs[i] = v;
+    }
+    return *this;
+  }
+
+  BIGINT_CONSTEXPR14 FixedBigInt& operator>>=(size_t bits) {
+    const size_t shift = bits / BigInt::internal_bitlen, sh = bits % BigInt::internal_bitlen;
+    BIGINT_UNROLL
+    for (size_t i = 0; i < limbs; ++i) {
+      internal_type v = 0;
+      if (i + shift < limbs) {
+        v = m_limbs[i + shift] >> sh;
+        if (sh && i + shift + 1 < limbs)
+          v |= m_limbs[i + shift + 1] << (BigInt::internal_bitlen - sh);
+      }
+      m_limbs[i] = v;
+    }
+    return *this;
+  }
+
+  friend BIGINT_CONSTEXPR14 FixedBigInt operator+(const FixedBigInt &a, const FixedBigInt &b) {
+    FixedBigInt r;
+    add(r, a, b);
+    return r;
+  }
+
+  friend BIGINT_CONSTEXPR14 FixedBigInt operator-(const FixedBigInt &a, const FixedBigInt &b) {
+    FixedBigInt r;
+    sub(r, a, b);
+    return r;
+  }
+
+  /**
+   * the low Bits bits of the product, the columns above them are never computed.
+   */
+  friend BIGINT_CONSTEXPR14 FixedBigInt operator*(const FixedBigInt &a, const FixedBigInt &b) {
+    FixedBigInt r;
+    BIGINT_UNROLL
+    for (size_t i = 0; i < limbs; ++i) {
+      internal_type carry = 0;
+      BIGINT_UNROLL
+      for (size_t j = 0; i + j < limbs; ++j) {
+        internal_type hi = 0;
+        internal_type lo = BigInt::mul_limb(a.m_limbs[i], b.m_limbs[j], hi);
+        lo += carry;
+        hi += lo < carry;
+        r.m_limbs[i+j] += lo;
+        carry = hi + (r.m_limbs[i+j] < lo);
+      }
+    }
+    return r;
+  }
+
+  /**
+   * the full product of a and b.
+   */
+  friend BIGINT_CONSTEXPR14 FixedBigInt<2*Bits> mul_wide(const FixedBigInt &a, const FixedBigInt &b) {
+    FixedBigInt<2*Bits> r;
+    BIGINT_UNROLL
+    for (size_t i = 0; i < limbs; ++i) {
+      internal_type carry = 0;
+      BIGINT_UNROLL
+      for (size_t j = 0; j < limbs; ++j) {
+        internal_type hi = 0;
+        internal_type lo = BigInt::mul_limb(a.m_limbs[i], b.m_limbs[j], hi);
+        lo += carry;
+        hi += lo < carry;
+        r.m_limbs[i+j] += lo;
+        carry = hi + (r.m_limbs[i+j] < lo);
+      }
+      r.m_limbs[i + limbs] = carry;
+    }
+    return r;
+  }
+
+  friend BIGINT_CONSTEXPR14 FixedBigInt operator<<(const FixedBigInt &a, size_t bits) {
+    FixedBigInt r(a);
+    r <<= bits;
+    return r;
+  }
+
+  friend BIGINT_CONSTEXPR14 FixedBigInt operator>>(const FixedBigInt &a, size_t bits) {
+    FixedBigInt r(a);
+    r >>= bits;
+    return r;
+  }
+
+  friend BIGINT_CONSTEXPR14 bool operator==(const FixedBigInt &a, const FixedBigInt &b) {
+    return compare(a, b) == 0;
+  }
+
+  friend BIGINT_CONSTEXPR14 bool operator!=(const FixedBigInt &a, const FixedBigInt &b) {
+    return compare(a, b) != 0;
+  }
+
+  friend BIGINT_CONSTEXPR14 bool operator<(const FixedBigInt &a, const FixedBigInt &b) {
+    return compare(a, b) < 0;
+  }
+
+  friend BIGINT_CONSTEXPR14 bool operator<=(const FixedBigInt &a, const FixedBigInt &b) {
+    return compare(a, b) <= 0;
+  }
+
+  friend BIGINT_CONSTEXPR14 bool operator>(const FixedBigInt &a, const FixedBigInt &b) {
+    return compare(a, b) > 0;
+  }
+
+  friend BIGINT_CONSTEXPR14 bool operator>=(const FixedBigInt &a, const FixedBigInt &b) {
+    return compare(a, b) >= 0;
+  }
+};
+
+template <size_t Bits>
+const size_t FixedBigInt<Bits>::limbs;